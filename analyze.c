@@ -0,0 +1,238 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "analyze.h"
+#include "search.h"
+
+/***********************************************************************
+
+ Batch analysis
+
+ reader (calling thread) --> workers (one per core) --> writer
+
+ Positions travel in batches through a fixed ring of slots, batch n always in
+ slot n % N_SLOTS. The reader fills slots in order, workers claim filled ones
+ in order and the writer empties them in order, so output lines up with input
+ and no more than N_SLOTS batches are ever in memory.
+
+***********************************************************************/
+
+#define BATCH        1024
+#define SLOTS_PER_WORKER 4
+#define AN_TT_BITS   20  // 1M entries, 16MB per worker
+
+typedef enum { SLOT_FREE, SLOT_FILLED, SLOT_DONE } slot_state;
+
+typedef struct batch{
+
+	slot_state    state;
+	size_t        n;
+	board_t       boards[BATCH];
+	bool          valid[BATCH];   // false: unparseable input line
+	search_result results[BATCH];
+
+}batch;
+
+static struct analysis{
+
+	pthread_mutex_t lock;
+	pthread_cond_t  changed;
+
+	batch*          slots;
+	unsigned        n_slots;
+	int             depth;
+
+	unsigned long   n_read;       // batches filled so far
+	unsigned long   n_claimed;    // batches handed to a worker
+	unsigned long   n_written;
+	bool            eof;
+
+	FILE*           out;
+
+}an;
+
+static void* analyze_worker(void* arg){
+
+	(void)arg;
+	search_ctx* s = search_new(AN_TT_BITS);
+	if(!s){ perror("analyze"); exit(1); }
+
+	while(1){
+
+		pthread_mutex_lock(&an.lock);
+		while(an.n_claimed == an.n_read && !an.eof){ pthread_cond_wait(&an.changed, &an.lock); }
+		if(an.n_claimed == an.n_read){ pthread_mutex_unlock(&an.lock); break; }
+		batch* b = &an.slots[an.n_claimed++ % an.n_slots];
+		pthread_mutex_unlock(&an.lock);
+
+		// a position's result must not depend on which worker saw which positions before it
+		for(size_t i = 0; i < b->n; i++){
+			if(!b->valid[i]) continue;
+			search_forget(s);
+			search_position(s, b->boards[i], an.depth, &b->results[i]);
+		}
+
+		pthread_mutex_lock(&an.lock);
+		b->state = SLOT_DONE;
+		pthread_cond_broadcast(&an.changed);
+		pthread_mutex_unlock(&an.lock);
+	}
+
+	search_free(s);
+	return NULL;
+}
+
+// board  legal-move mask  best move  value of up/down/left/right ('-' if illegal)
+static void write_result(board_t b, const search_result* r){
+
+	unsigned mask = 0;
+	for(int dir = 0; dir < N_DIRS; dir++){ if(r->value[dir] >= 0) mask |= 1u << dir; }
+
+	fprintf(an.out, "%0*llx %x %s", N_CELLS, (unsigned long long)b, mask, (r->best_move < 0) ? "-" : dir_names[r->best_move]);
+	for(int dir = 0; dir < N_DIRS; dir++){
+		if(r->value[dir] >= 0) fprintf(an.out, " %.2f", r->value[dir]);
+		else fprintf(an.out, " -");
+	}
+	fputc('\n', an.out);
+}
+
+static void* analyze_writer(void* arg){
+
+	(void)arg;
+
+	while(1){
+
+		pthread_mutex_lock(&an.lock);
+		batch* b = &an.slots[an.n_written % an.n_slots];
+		while(!(an.n_written < an.n_read && b->state == SLOT_DONE) && !(an.eof && an.n_written == an.n_read)){
+			pthread_cond_wait(&an.changed, &an.lock);
+		}
+		if(an.n_written == an.n_read){ pthread_mutex_unlock(&an.lock); break; }
+		pthread_mutex_unlock(&an.lock);
+
+		for(size_t i = 0; i < b->n; i++){
+			if(b->valid[i]) write_result(b->boards[i], &b->results[i]);
+			else fprintf(an.out, "invalid\n");
+		}
+
+		pthread_mutex_lock(&an.lock);
+		b->state = SLOT_FREE;
+		an.n_written++;
+		pthread_cond_broadcast(&an.changed);
+		pthread_mutex_unlock(&an.lock);
+	}
+
+	fflush(an.out);
+	return NULL;
+}
+
+// one hex board per line, blank lines and '#' comments skipped; a line too
+// long for the buffer is consumed whole and reported as one invalid position
+// Return: false at end of input
+static bool read_text(FILE* in, board_t* b, bool* valid){
+
+	char line[256];
+
+	while(fgets(line, sizeof(line), in)){
+
+		bool too_long = false;
+		if(!strchr(line, '\n')){
+			int c;
+			while((c = getc(in)) != EOF && c != '\n'){ too_long = true; }
+		}
+
+		char* p = line;
+		char* end;
+		while(isspace((unsigned char)*p)) p++;
+		if(*p == '#') continue;
+		if(*p == '\0' && !too_long) continue;
+
+		errno = 0;
+		*b = strtoull(p, &end, 16);
+		while(isspace((unsigned char)*end)) end++;
+		*valid = (!too_long && isxdigit((unsigned char)*p) && errno != ERANGE && *end == '\0'
+		          && (N_CELLS == 16 || (*b >> (4 * N_CELLS)) == 0));
+		return true;
+	}
+	return false;
+}
+
+/***********************************************************************
+
+ analyze()
+
+ Evaluate every position read from 'in' to the given search depth, one line
+ per position on 'out'. Text input is one hex board per line, binary input
+ is a stream of native-endian 64 bit boards.
+
+ Return: 0 on success
+
+***********************************************************************/
+
+int analyze(FILE* in, FILE* out, bool binary, int depth, int n_threads){
+
+	pthread_t writer;
+	pthread_t* workers;
+
+	if(n_threads <= 0){ n_threads = (int)sysconf(_SC_NPROCESSORS_ONLN); }
+	if(n_threads <= 0){ n_threads = 1; }
+
+	pthread_mutex_init(&an.lock, NULL);
+	pthread_cond_init(&an.changed, NULL);
+	an.n_slots = (unsigned)n_threads * SLOTS_PER_WORKER;
+	an.slots = calloc(an.n_slots, sizeof(batch));
+	an.depth = depth;
+	an.out = out;
+	workers = calloc((size_t)n_threads, sizeof(pthread_t));
+	if(!an.slots || !workers){ perror("analyze"); return 1; }
+
+	for(int i = 0; i < n_threads; i++){
+		if(pthread_create(&workers[i], NULL, analyze_worker, NULL)){ perror("pthread_create"); return 1; }
+	}
+	if(pthread_create(&writer, NULL, analyze_writer, NULL)){ perror("pthread_create"); return 1; }
+
+	while(1){
+
+		pthread_mutex_lock(&an.lock);
+		batch* b = &an.slots[an.n_read % an.n_slots];
+		while(b->state != SLOT_FREE){ pthread_cond_wait(&an.changed, &an.lock); }
+		pthread_mutex_unlock(&an.lock);
+
+		b->n = 0;
+		if(binary){
+			size_t bytes = fread(b->boards, 1, BATCH * sizeof(board_t), in);
+			b->n = bytes / sizeof(board_t);
+			for(size_t i = 0; i < b->n; i++){ b->valid[i] = (N_CELLS == 16 || (b->boards[i] >> (4 * N_CELLS)) == 0); }
+			if(bytes % sizeof(board_t)){
+				// input ended part way through a board
+				fprintf(stderr, "analyze: %zu trailing bytes are not a whole board\n", bytes % sizeof(board_t));
+				b->valid[b->n++] = false;
+			}
+		}else{
+			while(b->n < BATCH && read_text(in, &b->boards[b->n], &b->valid[b->n])){ b->n++; }
+		}
+
+		pthread_mutex_lock(&an.lock);
+		if(b->n){
+			b->state = SLOT_FILLED;
+			an.n_read++;
+		}
+		if(b->n < BATCH){ an.eof = true; }
+		pthread_cond_broadcast(&an.changed);
+		pthread_mutex_unlock(&an.lock);
+
+		if(an.eof) break;
+	}
+
+	for(int i = 0; i < n_threads; i++){ pthread_join(workers[i], NULL); }
+	pthread_join(writer, NULL);
+
+	free(workers);
+	free(an.slots);
+	return ferror(in) ? 1 : 0;
+}
@@ -0,0 +1,26 @@
+#ifndef ANALYZE_H
+#define ANALYZE_H
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "board.h"
+
+/***********************************************************************
+
+ 2048 --analyze [--binary] [--depth N] [--threads N] < positions
+
+ For each position read, writes one line:
+
+   <board> <legal-move mask> <best move> <value up> <value down> <value left> <value right>
+
+ board as hex, mask bit n set if dir_t n is legal, values as expected points
+ over the search depth with '-' for illegal moves.
+
+***********************************************************************/
+
+#define ANALYZE_DEPTH 3
+
+int analyze(FILE* in, FILE* out, bool binary, int depth, int n_threads);
+
+#endif
@@ -0,0 +1,271 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "board.h"
+#include "bench.h"
+
+#define BENCH_POSITIONS 1000000
+#define BENCH_ROUNDS    10
+
+static uint64_t rng_state = 0x2048;
+
+static uint64_t next_random(void){
+
+	rng_state ^= rng_state >> 12;
+	rng_state ^= rng_state << 25;
+	rng_state ^= rng_state >> 27;
+	return rng_state * 0x2545F4914F6CDD1Dull;
+}
+
+static double now_sec(void){
+
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static board_t spawn_tile(board_t b){
+
+	int n_empty = board_count_empty(b);
+	if(n_empty == 0) return b;
+
+	uint64_t r = next_random();
+	int k = (int)(r % (uint64_t)n_empty);
+	int v = ((r >> 32) % 10) ? 1 : 2;
+
+	for(int i = 0; i < N_CELLS; i++){
+		if((b >> (4 * i)) & 0xF) continue;
+		if(k-- == 0) return b | ((board_t)v << (4 * i));
+	}
+	return b;
+}
+
+// every position met in random games, n of them
+static board_t* random_positions(size_t n){
+
+	board_t* pos = malloc(n * sizeof(board_t));
+	if(!pos){ perror("bench"); exit(1); }
+
+	board_t b = spawn_tile(spawn_tile(0));
+	for(size_t i = 0; i < n; i++){
+
+		pos[i] = b;
+
+		board_t next = b;
+		for(int tries = 0; tries < 16 && next == b; tries++){ next = board_move(b, (int)(next_random() % N_DIRS), NULL); }
+		b = (next == b) ? spawn_tile(spawn_tile(0)) : spawn_tile(next);  // stuck: new game
+	}
+	return pos;
+}
+
+// every position up to 'plies' moves into a game, as a search or the solver sees them
+static size_t opening_positions(board_t** out, int plies){
+
+	size_t n = 0, cap = 1024;
+	board_t* pos = malloc(cap * sizeof(board_t));
+	if(!pos){ perror("bench"); exit(1); }
+
+	for(int i = 0; i < N_CELLS; i++){
+		for(int j = i + 1; j < N_CELLS; j++){
+			for(int v = 0; v < 4; v++){
+				if(n == cap){ pos = realloc(pos, (cap *= 2) * sizeof(board_t)); if(!pos){ perror("bench"); exit(1); } }
+				pos[n++] = ((board_t)(1 + (v & 1)) << (4 * i)) | ((board_t)(1 + (v >> 1)) << (4 * j));
+			}
+		}
+	}
+
+	size_t from = 0;
+	for(int ply = 0; ply < plies; ply++){
+		size_t to = n;
+		for(size_t k = from; k < to; k++){
+			for(int dir = 0; dir < N_DIRS; dir++){
+				board_t a = board_move(pos[k], dir, NULL);
+				if(a == pos[k]) continue;
+				for(int i = 0; i < N_CELLS; i++){
+					if((a >> (4 * i)) & 0xF) continue;
+					for(int v = 1; v <= 2; v++){
+						if(n == cap){ pos = realloc(pos, (cap *= 2) * sizeof(board_t)); if(!pos){ perror("bench"); exit(1); } }
+						pos[n++] = a | ((board_t)v << (4 * i));
+					}
+				}
+			}
+		}
+		from = to;
+	}
+	*out = pos;
+	return n;
+}
+
+static int cmp_board(const void* a, const void* b){
+
+	board_t x = *(const board_t*)a, y = *(const board_t*)b;
+	return (x > y) - (x < y);
+}
+
+static size_t count_distinct(board_t* v, size_t n){
+
+	size_t d = 0;
+	qsort(v, n, sizeof(v[0]), cmp_board);
+	for(size_t i = 0; i < n; i++){ if(i == 0 || v[i] != v[i-1]) d++; }
+	return d;
+}
+
+// what canonicalizing costs without the bit tricks
+static board_t canonical_by_cells(board_t b){
+
+	board_t best = b;
+
+	for(int s = 1; s < N_SYMS; s++){
+		board_t c = 0;
+		for(int col = 0; col < N_COLS; col++){
+			for(int row = 0; row < N_ROWS; row++){
+				int x = col, y = row;
+				if(s & SYM_TRANSPOSE){ x = row; y = col; }
+				if(s & SYM_FLIP_H) x = N_COLS - 1 - x;
+				if(s & SYM_FLIP_V) y = N_ROWS - 1 - y;
+				c = board_set(c, x, y, board_get(b, col, row));
+			}
+		}
+		if(c < best) best = c;
+	}
+	return best;
+}
+
+static int bench_sym(void){
+
+	board_t* pos = random_positions(BENCH_POSITIONS);
+	board_t* canon = malloc(BENCH_POSITIONS * sizeof(board_t));
+	volatile board_t sink = 0;
+	if(!canon){ perror("bench"); return 1; }
+
+	double t = now_sec();
+	for(int r = 0; r < BENCH_ROUNDS; r++){
+		for(size_t i = 0; i < BENCH_POSITIONS; i++){ sink ^= board_canonical(pos[i], NULL); }
+	}
+	double fast = BENCH_ROUNDS * (double)BENCH_POSITIONS / (now_sec() - t);
+
+	t = now_sec();
+	for(size_t i = 0; i < BENCH_POSITIONS; i++){ sink ^= canonical_by_cells(pos[i]); }
+	double slow = BENCH_POSITIONS / (now_sec() - t);
+
+	printf("canonicalize: %.1fM/sec (cell by cell: %.1fM/sec, %.1fx)\n", fast / 1e6, slow / 1e6, fast / slow);
+
+	for(size_t i = 0; i < BENCH_POSITIONS; i++){
+		canon[i] = board_canonical(pos[i], NULL);
+		if(canon[i] != canonical_by_cells(pos[i])){ fprintf(stderr, "mismatch on %016llx\n", (unsigned long long)pos[i]); return 1; }
+	}
+
+	size_t raw = count_distinct(pos, BENCH_POSITIONS);
+	size_t sym = count_distinct(canon, BENCH_POSITIONS);
+	printf("%d positions from random play: %zu distinct, %zu up to symmetry (%.2fx fewer, %.1fMB -> %.1fMB at 16 bytes an entry)\n",
+	       BENCH_POSITIONS, raw, sym, (double)raw / sym, raw * 16 / 1048576.0, sym * 16 / 1048576.0);
+
+	free(pos);
+	free(canon);
+
+	// exhaustive sets, as searched or solved, are where the symmetric copies pile up
+	size_t n = opening_positions(&pos, 2);
+	canon = malloc(n * sizeof(board_t));
+	if(!canon){ perror("bench"); return 1; }
+	for(size_t i = 0; i < n; i++){ canon[i] = board_canonical(pos[i], NULL); }
+
+	raw = count_distinct(pos, n);
+	sym = count_distinct(canon, n);
+	printf("every position 2 moves into a game: %zu distinct, %zu up to symmetry (%.2fx fewer, %.1fKB -> %.1fKB at 16 bytes an entry)\n",
+	       raw, sym, (double)raw / sym, raw * 16 / 1024.0, sym * 16 / 1024.0);
+
+	free(pos);
+	free(canon);
+	return 0;
+}
+
+// the legal-move mask as it used to be found: make every move, see what changed
+static unsigned legal_by_moving(board_t b){
+
+	unsigned mask = 0;
+	for(int dir = 0; dir < N_DIRS; dir++){ if(board_move(b, dir, NULL) != b) mask |= 1u << dir; }
+	return mask;
+}
+
+// the old no_moves_left(), on an unpacked board (only meaningful on a full one)
+static int no_moves_by_scan(uint8_t board[N_COLS][N_ROWS]){
+
+	int row, col;
+	for(row = 0; row < N_ROWS - 1; row++){
+		for(col = 0; col < N_COLS - 1; col++){
+			if(board[col][row] == board[col+1][row]){ return 0; }
+			if(board[col][row] == board[col][row+1]){ return 0; }
+		}
+		if(board[col][row] == board[col][row+1]){ return 0; }
+	}
+	for(col = 0; col < N_COLS - 1; col++){
+		if(board[col][row] == board[col+1][row]){ return 0; }
+	}
+	return 1;
+}
+
+static int bench_mask(void){
+
+	board_t* pos = random_positions(BENCH_POSITIONS);
+	uint8_t (*unpacked)[N_COLS][N_ROWS] = malloc(BENCH_POSITIONS * sizeof(*unpacked));
+	volatile unsigned sink = 0;
+	size_t full = 0;
+	if(!unpacked){ perror("bench"); return 1; }
+
+	for(size_t i = 0; i < BENCH_POSITIONS; i++){
+		if(board_legal_moves(pos[i]) != legal_by_moving(pos[i])){
+			fprintf(stderr, "mismatch on %016llx\n", (unsigned long long)pos[i]);
+			return 1;
+		}
+		for(int col = 0; col < N_COLS; col++){
+			for(int row = 0; row < N_ROWS; row++){ unpacked[i][col][row] = (uint8_t)board_get(pos[i], col, row); }
+		}
+		if(board_count_empty(pos[i]) == 0){
+			full++;
+			if(no_moves_by_scan(unpacked[i]) != (board_legal_moves(pos[i]) == 0)){
+				fprintf(stderr, "scan disagrees on %016llx\n", (unsigned long long)pos[i]);
+				return 1;
+			}
+		}
+	}
+
+	double t = now_sec();
+	for(int r = 0; r < BENCH_ROUNDS; r++){
+		for(size_t i = 0; i < BENCH_POSITIONS; i++){ sink ^= board_legal_moves(pos[i]); }
+	}
+	double mask = BENCH_ROUNDS * (double)BENCH_POSITIONS / (now_sec() - t);
+
+	t = now_sec();
+	for(int r = 0; r < BENCH_ROUNDS; r++){
+		for(size_t i = 0; i < BENCH_POSITIONS; i++){ sink ^= legal_by_moving(pos[i]); }
+	}
+	double moving = BENCH_ROUNDS * (double)BENCH_POSITIONS / (now_sec() - t);
+
+	t = now_sec();
+	for(int r = 0; r < BENCH_ROUNDS; r++){
+		for(size_t i = 0; i < BENCH_POSITIONS; i++){ sink ^= (unsigned)no_moves_by_scan(unpacked[i]); }
+	}
+	double scan = BENCH_ROUNDS * (double)BENCH_POSITIONS / (now_sec() - t);
+
+	printf("%d positions from random play (%zu full), all masks agree\n", BENCH_POSITIONS, full);
+	printf("board_legal_moves(): %7.1fM/sec  %6.1fns\n", mask / 1e6, 1e9 / mask);
+	printf("move and compare:    %7.1fM/sec  %6.1fns  (%.1fx slower)\n", moving / 1e6, 1e9 / moving, mask / moving);
+	printf("no_moves_left scan:  %7.1fM/sec  %6.1fns  (%.1fx slower, and terminal only)\n", scan / 1e6, 1e9 / scan, mask / scan);
+
+	free(pos);
+	free(unpacked);
+	return 0;
+}
+
+int bench(const char* name){
+
+	board_init();
+
+	if(!strcmp(name, "sym"))  return bench_sym();
+	if(!strcmp(name, "mask")) return bench_mask();
+
+	fprintf(stderr, "unknown benchmark '%s' (try: sym, mask)\n", name);
+	return 1;
+}
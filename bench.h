@@ -0,0 +1,22 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+/***********************************************************************
+
+ 2048 --bench NAME
+
+ Micro-benchmarks on positions from random play:
+
+   sym   canonicalizations/sec, bit tricks vs. cell by cell, and how many
+         fewer entries a cache or dataset needs when keyed canonically
+
+   mask  legal-move masks/sec from board_legal_moves() vs. making each move
+         and comparing, and vs. the old pairwise no_moves_left() scan
+
+ Return: 0 on success, 1 for an unknown NAME
+
+***********************************************************************/
+
+int bench(const char* name);
+
+#endif
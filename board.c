@@ -0,0 +1,321 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "board.h"
+
+const char* dir_names[N_DIRS] = { "up", "down", "left", "right" };
+
+/***********************************************************************
+
+ Line tables
+
+ Every move is a set of independent lines slid towards a wall, so each
+ possible line (packed, wall end in the low nibble) is worked out once here.
+ A line of 4 cells is 16 bits: 64K entries.
+
+***********************************************************************/
+
+#define ROW_ENTRIES (1u << (4 * N_COLS))  // lines for left/right
+#define COL_ENTRIES (1u << (4 * N_ROWS))  // lines for up/down
+
+typedef struct line_result{
+
+	uint16_t line;
+	uint32_t points;
+
+}line_result;
+
+static line_result row_table[ROW_ENTRIES];
+static line_result col_table[COL_ENTRIES];
+
+// same rules as traverse() in thing.c
+static line_result slide_line(unsigned in, int len){
+
+	line_result r = { .line = 0, .points = 0 };
+	int  out[4];
+	bool smushed[4];
+	int  n = 0;
+
+	for(int i = 0; i < len; i++){
+
+		int v = (in >> (4 * i)) & 0xF;
+		if(!v) continue;
+
+		if(n && out[n-1] == v && !smushed[n-1]){
+			out[n-1] = (v < MAX_TILE) ? v + 1 : MAX_TILE;
+			r.points += (1u << out[n-1]);
+			smushed[n-1] = true;
+		}else{
+			out[n] = v;
+			smushed[n] = false;
+			n++;
+		}
+	}
+	for(int i = 0; i < n; i++){ r.line |= (uint16_t)(out[i] << (4 * i)); }
+	return r;
+}
+
+// low bit of each nibble: all cells, cells with a right hand / lower neighbour
+static board_t cell_bits, has_right, has_below;
+
+static void build_sym_tables(void);  // see Symmetry below
+
+void board_init(void){
+
+	for(unsigned i = 0; i < ROW_ENTRIES; i++){ row_table[i] = slide_line(i, N_COLS); }
+	for(unsigned i = 0; i < COL_ENTRIES; i++){ col_table[i] = slide_line(i, N_ROWS); }
+
+	cell_bits = has_right = has_below = 0;
+	for(int i = 0; i < N_CELLS; i++){
+		cell_bits |= (board_t)1 << (4 * i);
+		if(i % N_COLS != N_COLS - 1) has_right |= (board_t)1 << (4 * i);
+		if(i < N_CELLS - N_COLS)     has_below |= (board_t)1 << (4 * i);
+	}
+
+	build_sym_tables();
+}
+
+/***********************************************************************
+
+ board_move()
+
+ Slide the packed board in direction dir.
+
+ Return: the new board (equal to b if nothing moved), points scored via *points
+
+***********************************************************************/
+
+board_t board_move(board_t b, int dir, uint32_t* points){
+
+	board_t out = 0;
+	uint32_t pts = 0;
+	int i, k;
+
+	switch(dir){
+
+		case DIR_LEFT:
+		case DIR_RIGHT:
+		for(int row = 0; row < N_ROWS; row++){
+			unsigned line = 0;
+			for(i = 0; i < N_COLS; i++){
+				k = (dir == DIR_LEFT) ? i : N_COLS - 1 - i;
+				line |= (unsigned)board_get(b, k, row) << (4 * i);
+			}
+			line_result* r = &row_table[line];
+			pts += r->points;
+			for(i = 0; i < N_COLS; i++){
+				k = (dir == DIR_LEFT) ? i : N_COLS - 1 - i;
+				out = board_set(out, k, row, (r->line >> (4 * i)) & 0xF);
+			}
+		}
+		break;
+
+		case DIR_UP:
+		case DIR_DOWN:
+		for(int col = 0; col < N_COLS; col++){
+			unsigned line = 0;
+			for(i = 0; i < N_ROWS; i++){
+				k = (dir == DIR_UP) ? i : N_ROWS - 1 - i;
+				line |= (unsigned)board_get(b, col, k) << (4 * i);
+			}
+			line_result* r = &col_table[line];
+			pts += r->points;
+			for(i = 0; i < N_ROWS; i++){
+				k = (dir == DIR_UP) ? i : N_ROWS - 1 - i;
+				out = board_set(out, col, k, (r->line >> (4 * i)) & 0xF);
+			}
+		}
+		break;
+
+		default:
+		return b;
+	}
+
+	if(points) *points = pts;
+	return out;
+}
+
+/***********************************************************************
+
+ board_legal_moves()
+
+ Which moves would change the board, without making any of them. A line can
+ move towards a wall if some tile has a gap on that side, or if two
+ neighbours are equal. Both tests are done for every cell at once on the
+ packed word: one bit per nibble for 'occupied' and for 'equals the next
+ cell along', shifted by one cell for left/right and by one row for up/down.
+ No branches, no loops over cells.
+
+ Return: bit dir set for each legal dir_t
+
+***********************************************************************/
+
+// low bit of each nibble set if the nibble is non-zero
+static inline board_t nibble_nonzero(board_t x){
+
+	x |= x >> 1;
+	x |= x >> 2;
+	return x & 0x1111111111111111ull;
+}
+
+unsigned board_legal_moves(board_t b){
+
+	const int row = 4 * N_COLS;
+
+	board_t full  = nibble_nonzero(b) & cell_bits;
+	board_t empty = ~full & cell_bits;
+	board_t eq_h  = ~nibble_nonzero(b ^ (b >> 4)) & full & has_right;   // equal to the cell on its right
+	board_t eq_v  = ~nibble_nonzero(b ^ (b >> row)) & full & has_below; // equal to the cell below
+
+	board_t left  = ((empty & (full >> 4)) & has_right) | eq_h;
+	board_t right = ((full & (empty >> 4)) & has_right) | eq_h;
+	board_t up    = ((empty & (full >> row)) & has_below) | eq_v;
+	board_t down  = ((full & (empty >> row)) & has_below) | eq_v;
+
+	return ((unsigned)(up != 0)    << DIR_UP)
+	     | ((unsigned)(down != 0)  << DIR_DOWN)
+	     | ((unsigned)(left != 0)  << DIR_LEFT)
+	     | ((unsigned)(right != 0) << DIR_RIGHT);
+}
+
+int board_count_empty(board_t b){
+
+	int n = 0;
+	for(int i = 0; i < N_CELLS; i++, b >>= 4){ n += ((b & 0xF) == 0); }
+	return n;
+}
+
+uint32_t board_tile_sum(board_t b){
+
+	uint32_t sum = 0;
+	for(int i = 0; i < N_CELLS; i++, b >>= 4){ if(b & 0xF) sum += (1u << (b & 0xF)); }
+	return sum;
+}
+
+int board_max_tile(board_t b){
+
+	int m = 0;
+	for(int i = 0; i < N_CELLS; i++, b >>= 4){ if((int)(b & 0xF) > m) m = (int)(b & 0xF); }
+	return m;
+}
+
+/***********************************************************************
+
+ Symmetry
+
+ On the 4x4 board each generator is a handful of mask-and-shift steps on the
+ packed word (rows are 16 bit lanes, cells nibbles within them). Other sizes
+ go through a permutation table.
+
+***********************************************************************/
+
+#if N_COLS == 4 && N_ROWS == 4
+
+static void build_sym_tables(void){}  // nothing to precompute
+
+static inline board_t flip_h(board_t x){
+
+	x = ((x & 0xFF00FF00FF00FF00ull) >> 8) | ((x & 0x00FF00FF00FF00FFull) << 8);
+	return ((x & 0xF0F0F0F0F0F0F0F0ull) >> 4) | ((x & 0x0F0F0F0F0F0F0F0Full) << 4);
+}
+
+static inline board_t flip_v(board_t x){
+
+	x = (x >> 32) | (x << 32);
+	return ((x & 0xFFFF0000FFFF0000ull) >> 16) | ((x & 0x0000FFFF0000FFFFull) << 16);
+}
+
+static inline board_t transpose(board_t x){
+
+	// swap the off-diagonal cells of each 2x2 block, then the off-diagonal 2x2 blocks
+	board_t a = (x & 0xF0F00F0FF0F00F0Full) | ((x & 0x0000F0F00000F0F0ull) << 12) | ((x & 0x0F0F00000F0F0000ull) >> 12);
+	return (a & 0xFF00FF0000FF00FFull) | ((a & 0x00FF00FF00000000ull) >> 24) | ((a & 0x00000000FF00FF00ull) << 24);
+}
+
+board_t board_transform(board_t b, int sym){
+
+	if(sym & SYM_TRANSPOSE) b = transpose(b);
+	if(sym & SYM_FLIP_H)    b = flip_h(b);
+	if(sym & SYM_FLIP_V)    b = flip_v(b);
+	return b;
+}
+
+board_t board_canonical(board_t b, int* sym){
+
+	board_t c[8];
+	int best = 0;
+
+	c[0] = b;
+	c[SYM_FLIP_H] = flip_h(b);
+	c[SYM_FLIP_V] = flip_v(b);
+	c[SYM_FLIP_H | SYM_FLIP_V] = flip_v(c[SYM_FLIP_H]);
+	c[SYM_TRANSPOSE] = transpose(b);
+	c[SYM_TRANSPOSE | SYM_FLIP_H] = flip_h(c[SYM_TRANSPOSE]);
+	c[SYM_TRANSPOSE | SYM_FLIP_V] = flip_v(c[SYM_TRANSPOSE]);
+	c[SYM_TRANSPOSE | SYM_FLIP_H | SYM_FLIP_V] = flip_v(c[SYM_TRANSPOSE | SYM_FLIP_H]);
+
+	for(int s = 1; s < 8; s++){ if(c[s] < c[best]) best = s; }
+
+	if(sym) *sym = best;
+	return c[best];
+}
+
+#else
+
+// sym_src[s][i]: which cell of the original lands in cell i
+static uint8_t sym_src[8][N_CELLS];
+
+static void build_sym_tables(void){
+
+	for(int s = 0; s < N_SYMS; s++){
+		for(int col = 0; col < N_COLS; col++){
+			for(int row = 0; row < N_ROWS; row++){
+				int c = col, r = row;
+				// undo in reverse order: flip_v, flip_h, transpose
+				if(s & SYM_FLIP_V)    r = N_ROWS - 1 - r;
+				if(s & SYM_FLIP_H)    c = N_COLS - 1 - c;
+				if(s & SYM_TRANSPOSE){ int t = c; c = r; r = t; }
+				sym_src[s][col + row * N_COLS] = (uint8_t)(c + r * N_COLS);
+			}
+		}
+	}
+}
+
+board_t board_transform(board_t b, int sym){
+
+	board_t out = 0;
+
+	for(int i = 0; i < N_CELLS; i++){ out |= ((b >> (4 * sym_src[sym][i])) & 0xF) << (4 * i); }
+	return out;
+}
+
+board_t board_canonical(board_t b, int* sym){
+
+	board_t best = b;
+	int best_sym = 0;
+
+	for(int s = 1; s < N_SYMS; s++){
+		board_t c = board_transform(b, s);
+		if(c < best){ best = c; best_sym = s; }
+	}
+	if(sym) *sym = best_sym;
+	return best;
+}
+
+#endif
+
+int sym_dir_to_real(int sym, int dir){
+
+	// undo the generators in reverse order
+	if(sym & SYM_FLIP_V){
+		if(dir == DIR_UP) dir = DIR_DOWN; else if(dir == DIR_DOWN) dir = DIR_UP;
+	}
+	if(sym & SYM_FLIP_H){
+		if(dir == DIR_LEFT) dir = DIR_RIGHT; else if(dir == DIR_RIGHT) dir = DIR_LEFT;
+	}
+	if(sym & SYM_TRANSPOSE){
+		static const int transposed[N_DIRS] = { DIR_LEFT, DIR_RIGHT, DIR_UP, DIR_DOWN };
+		dir = transposed[dir];
+	}
+	return dir;
+}
@@ -0,0 +1,83 @@
+#ifndef BOARD_H
+#define BOARD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/***********************************************************************
+
+ Packed board
+
+ The whole board in a single 64 bit word, one nibble (tile value as log2) per
+ cell, cell (col,row) at nibble col + row * N_COLS. Used wherever positions are
+ searched, stored or compared, leaving game.board to the interactive front end.
+
+ Board size is fixed at compile time: build with -DN_COLS=3 -DN_ROWS=3 etc.
+
+***********************************************************************/
+
+#ifndef N_COLS
+#define N_COLS 4
+#endif
+#ifndef N_ROWS
+#define N_ROWS 4
+#endif
+
+#define N_CELLS (N_COLS * N_ROWS)
+
+#if N_CELLS > 16
+#error "packed board holds at most 16 cells"
+#endif
+#if N_COLS > 4 || N_ROWS > 4
+#error "move tables pack a row or column into 16 bits, so at most 4 cells a side"
+#endif
+
+#define MAX_TILE 15  // largest value a nibble can hold, 2^15 = 32K
+
+typedef uint64_t board_t;
+
+// same order as valid_key_t, less VK_NONE
+typedef enum { DIR_UP, DIR_DOWN, DIR_LEFT, DIR_RIGHT, N_DIRS } dir_t;
+
+extern const char* dir_names[N_DIRS];
+
+static inline int board_get(board_t b, int col, int row){
+
+	return (int)((b >> (4 * (col + row * N_COLS))) & 0xF);
+}
+
+static inline board_t board_set(board_t b, int col, int row, int v){
+
+	int shift = 4 * (col + row * N_COLS);
+	return (b & ~((board_t)0xF << shift)) | ((board_t)(v & 0xF) << shift);
+}
+
+void     board_init(void);  // build the move and symmetry tables, call once before using either
+board_t  board_move(board_t b, int dir, uint32_t* points);
+unsigned board_legal_moves(board_t b);  // bit dir set if that move would change the board, 0: game over
+int      board_count_empty(board_t b);
+uint32_t board_tile_sum(board_t b);
+int      board_max_tile(board_t b);
+
+/***********************************************************************
+
+ Symmetry
+
+ Rotations and reflections leave a position's value unchanged, so anything
+ cached, deduplicated or stored is keyed on one canonical representative of
+ the 8 symmetric copies (4 on a non-square board). A symmetry s is applied as:
+ transpose if (s & SYM_TRANSPOSE), then mirror left-right if (s & SYM_FLIP_H),
+ then mirror top-bottom if (s & SYM_FLIP_V).
+
+***********************************************************************/
+
+#define SYM_FLIP_H    1
+#define SYM_FLIP_V    2
+#define SYM_TRANSPOSE 4
+#define N_SYMS        ((N_COLS == N_ROWS) ? 8 : 4)
+
+board_t  board_transform(board_t b, int sym);
+board_t  board_canonical(board_t b, int* sym);  // smallest of the symmetric copies, and which symmetry made it
+int      sym_dir_to_real(int sym, int dir);     // a move in transformed space, as a move on the original board
+
+#endif
@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "board.h"
+#include "bot.h"
+#include "bot_shm.h"
+
+static uint64_t rng_state = 1;
+
+// xorshift64*: rand() is too slow, and not ours to reseed per game
+static uint64_t next_random(void){
+
+	rng_state ^= rng_state >> 12;
+	rng_state ^= rng_state << 25;
+	rng_state ^= rng_state >> 27;
+	return rng_state * 0x2545F4914F6CDD1Dull;
+}
+
+static spawn_policy spawn;
+
+static board_t spawn_tile(board_t b){
+
+	spawn_choice c;
+	if(!spawn(b, next_random(), &c)) return b;
+	return b | ((board_t)c.value << (4 * c.cell));
+}
+
+// true if name is a segment whose engine has exited without removing it
+static bool stale_segment(const char* name){
+
+	struct stat st;
+	bool stale = false;
+
+	int fd = shm_open(name, O_RDONLY, 0);
+	if(fd < 0) return false;
+	if(fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(bot_shm)){
+		bot_shm* shm = mmap(NULL, sizeof(bot_shm), PROT_READ, MAP_SHARED, fd, 0);
+		if(shm != MAP_FAILED){
+			// one still starting up, or of another protocol version, is left alone
+			stale = atomic_load_explicit(&shm->ready, memory_order_acquire)
+			        && shm->magic == BOT_SHM_MAGIC && shm->version == BOT_SHM_VERSION
+			        && kill((pid_t)shm->pid, 0) < 0 && errno == ESRCH;
+			munmap(shm, sizeof(bot_shm));
+		}
+	}
+	close(fd);
+	return stale;
+}
+
+int bot_serve(const char* name, spawn_policy policy){
+
+	int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+	if(fd < 0 && errno == EEXIST && stale_segment(name)){
+		shm_unlink(name);
+		fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+	}
+	if(fd < 0 && errno == EEXIST){ fprintf(stderr, "%s: already served by another engine\n", name); return 1; }
+	if(fd < 0){ perror(name); return 1; }
+	if(ftruncate(fd, sizeof(bot_shm)) < 0){ perror("ftruncate"); close(fd); shm_unlink(name); return 1; }
+
+	bot_shm* shm = mmap(NULL, sizeof(bot_shm), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if(shm == MAP_FAILED){ perror("mmap"); shm_unlink(name); return 1; }
+
+	memset(shm, 0, sizeof(*shm));
+	shm->magic = BOT_SHM_MAGIC;
+	shm->version = BOT_SHM_VERSION;
+	shm->cols = N_COLS;
+	shm->rows = N_ROWS;
+	shm->pid = (uint32_t)getpid();
+	atomic_store_explicit(&shm->ready, 1, memory_order_release);
+
+	spawn = policy;
+
+	bot_state st = { .game_over = 1 };
+	board_t board = 0;
+	bool quit = false;
+
+	while(!quit){
+
+		bot_cmd cmd;
+		unsigned spins = 0;
+		while(!bot_ring_pop(&shm->cmd_ring, shm->cmds, sizeof(cmd), &cmd)){ bot_relax(&spins); }
+
+		st.moved = 0;
+		switch(cmd.type){
+
+			case BOT_CMD_MOVE:
+			if(cmd.arg < N_DIRS && (st.legal & (1u << cmd.arg))){
+				uint32_t points;
+				board = spawn_tile(board_move(board, (int)cmd.arg, &points));
+				st.score += points;
+				st.moved = 1;
+			}
+			break;
+
+			case BOT_CMD_NEW_GAME:
+			rng_state = cmd.arg ? cmd.arg : 1;
+			board = spawn_tile(spawn_tile(0));
+			st.score = 0;
+			break;
+
+			case BOT_CMD_QUIT:
+			quit = true;
+			break;
+		}
+
+		st.seq++;
+		st.board = board;
+		st.legal = (uint8_t)board_legal_moves(board);
+		st.game_over = (st.legal == 0);
+
+		spins = 0;
+		while(!bot_ring_push(&shm->state_ring, shm->states, sizeof(st), &st)){ bot_relax(&spins); }
+	}
+
+	munmap(shm, sizeof(bot_shm));
+	shm_unlink(name);
+	return 0;
+}
@@ -0,0 +1,20 @@
+#ifndef BOT_H
+#define BOT_H
+
+#include "spawn.h"
+
+/***********************************************************************
+
+ 2048 --bot NAME
+
+ Serve the shared-memory bot protocol (bot_shm.h) on shm object NAME until
+ the bot sends BOT_CMD_QUIT. New tiles are placed by 'spawn', so bots can be
+ tested against the adversary as well as the real game.
+
+ Return: 0 on success
+
+***********************************************************************/
+
+int bot_serve(const char* name, spawn_policy spawn);
+
+#endif
@@ -0,0 +1,190 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "bot_shm.h"
+
+/***********************************************************************
+
+ Reference bot for the shared-memory protocol, and its benchmark
+
+ usage: 2048-bot [-g games] [-s seed] [-p] NAME
+
+ Attaches to an engine started with '2048 --bot NAME' and plays the given
+ number of games with a random legal move each turn, then reports moves/sec.
+ With -p the moves are pipelined instead: commands are pushed as fast as the
+ ring takes them, without waiting for each answer, which measures the
+ transport itself rather than the bot's think-act round trip.
+
+***********************************************************************/
+
+static double now_sec(void){
+
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static bot_shm* attach(const char* name){
+
+	int fd;
+	struct stat st;
+
+	// the engine may still be starting up
+	for(int tries = 0; (fd = shm_open(name, O_RDWR, 0)) < 0; tries++){
+		if(tries == 100){ perror(name); return NULL; }
+		usleep(50000);
+	}
+
+	// and may not have sized the segment yet: touching it before then is SIGBUS
+	for(int tries = 0; ; tries++){
+		if(fstat(fd, &st) < 0){ perror(name); close(fd); return NULL; }
+		if((size_t)st.st_size >= sizeof(bot_shm)) break;
+		if(tries == 100){ fprintf(stderr, "%s: not a 2048 engine (segment too small)\n", name); close(fd); return NULL; }
+		usleep(50000);
+	}
+
+	bot_shm* shm = mmap(NULL, sizeof(bot_shm), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if(shm == MAP_FAILED){ perror("mmap"); return NULL; }
+
+	unsigned spins = 0;
+	while(!atomic_load_explicit(&shm->ready, memory_order_acquire)){ bot_relax(&spins); }
+
+	if(shm->magic != BOT_SHM_MAGIC || shm->version != BOT_SHM_VERSION){
+		fprintf(stderr, "%s: not a 2048 engine (or a different protocol version)\n", name);
+		munmap(shm, sizeof(bot_shm));
+		return NULL;
+	}
+	return shm;
+}
+
+static void send_cmd(bot_shm* shm, uint32_t type, uint32_t arg){
+
+	bot_cmd cmd = { .type = type, .arg = arg };
+	unsigned spins = 0;
+	while(!bot_ring_push(&shm->cmd_ring, shm->cmds, sizeof(cmd), &cmd)){ bot_relax(&spins); }
+}
+
+static bot_state wait_state(bot_shm* shm){
+
+	bot_state st;
+	unsigned spins = 0;
+	while(!bot_ring_pop(&shm->state_ring, shm->states, sizeof(st), &st)){ bot_relax(&spins); }
+	return st;
+}
+
+static int max_tile(const bot_shm* shm, uint64_t board){
+
+	int m = 0;
+	for(unsigned i = 0; i < shm->cols * shm->rows; i++, board >>= 4){ if((int)(board & 0xF) > m) m = (int)(board & 0xF); }
+	return m;
+}
+
+// any legal move, chosen at random
+static uint32_t choose_move(unsigned legal){
+
+	int n = __builtin_popcount(legal);
+	int k = rand() % n;
+	for(uint32_t dir = 0; ; dir++){
+		if((legal >> dir) & 1){ if(k-- == 0) return dir; }
+	}
+}
+
+static void play(bot_shm* shm, long games, unsigned seed){
+
+	long moves = 0;
+	double total_score = 0;
+	int best_tile = 0;
+	double start = now_sec();
+
+	for(long g = 0; g < games; g++){
+
+		send_cmd(shm, BOT_CMD_NEW_GAME, seed + (unsigned)g);
+		bot_state st = wait_state(shm);
+
+		while(!st.game_over){
+			send_cmd(shm, BOT_CMD_MOVE, choose_move(st.legal));
+			st = wait_state(shm);
+			moves++;
+		}
+		total_score += st.score;
+		if(max_tile(shm, st.board) > best_tile) best_tile = max_tile(shm, st.board);
+	}
+
+	double secs = now_sec() - start;
+	printf("%ld games, %ld moves in %.3fs: %.0f moves/sec, mean score %.1f, best tile %d\n",
+	       games, moves, secs, moves / secs, total_score / games, 1 << best_tile);
+}
+
+static void play_pipelined(bot_shm* shm, long games, unsigned seed){
+
+	long sent = 0, answered = 0, moves = 0;
+	bot_state st;
+	double start = now_sec();
+
+	// cycle through the directions blind, restarting whenever an answer says the game is over
+	for(long g = 0; g < games; g++){
+
+		send_cmd(shm, BOT_CMD_NEW_GAME, seed + (unsigned)g);
+		long new_game = ++sent;  // answers arrive in order: this is its answer's number
+
+		bool over = false;
+		while(!over){
+			// keep the ring topped up, then drain whatever has come back
+			while(sent - answered < BOT_RING_SIZE / 2){
+				send_cmd(shm, BOT_CMD_MOVE, (uint32_t)(sent & 3));
+				sent++;
+			}
+			while(bot_ring_pop(&shm->state_ring, shm->states, sizeof(st), &st)){
+				answered++;
+				moves += st.moved;
+				if(st.game_over && answered > new_game) over = true;
+			}
+		}
+	}
+	while(answered < sent){ wait_state(shm); answered++; }
+
+	double secs = now_sec() - start;
+	printf("pipelined: %ld commands (%ld moves) in %.3fs: %.0f commands/sec\n",
+	       sent, moves, secs, sent / secs);
+}
+
+int main(int argc, char** argv){
+
+	long games = 1000;
+	unsigned seed = 1;
+	bool pipelined = false;
+	int opt;
+
+	while((opt = getopt(argc, argv, "g:s:p")) != -1){
+		switch(opt){
+			case 'g': games = atol(optarg); break;
+			case 's': seed = (unsigned)strtoul(optarg, NULL, 10); break;
+			case 'p': pipelined = true; break;
+			default:
+			fprintf(stderr, "usage: %s [-g games] [-s seed] [-p] NAME\n", argv[0]);
+			return 1;
+		}
+	}
+	if(optind >= argc){
+		fprintf(stderr, "usage: %s [-g games] [-s seed] [-p] NAME\n", argv[0]);
+		return 1;
+	}
+
+	bot_shm* shm = attach(argv[optind]);
+	if(!shm) return 1;
+
+	srand(seed);
+	if(pipelined) play_pipelined(shm, games, seed);
+	else play(shm, games, seed);
+
+	send_cmd(shm, BOT_CMD_QUIT, 0);
+	wait_state(shm);
+	munmap(shm, sizeof(bot_shm));
+	return 0;
+}
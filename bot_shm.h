@@ -0,0 +1,120 @@
+#ifndef BOT_SHM_H
+#define BOT_SHM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <sched.h>
+#include <time.h>
+
+/***********************************************************************
+
+ Shared-memory bot protocol
+
+ '2048 --bot NAME' creates the POSIX shared memory object NAME holding one
+ bot_shm and then plays whatever arrives on its command ring, answering every
+ command with a bot_state on the state ring. Both rings are single producer,
+ single consumer and lock free, so a bot in any language that can mmap a file
+ and do acquire/release loads and stores can drive the engine with no system
+ calls per move.
+
+ Layout is fixed-width, native endian. See bot_client.c for a reference bot.
+
+***********************************************************************/
+
+#define BOT_SHM_MAGIC   0x38343032u  // "2048"
+#define BOT_SHM_VERSION 2
+#define BOT_RING_SIZE   1024         // power of 2
+#define BOT_RING_MASK   (BOT_RING_SIZE - 1)
+
+typedef enum { BOT_CMD_MOVE, BOT_CMD_NEW_GAME, BOT_CMD_QUIT } bot_cmd_type;
+
+typedef struct bot_cmd{
+
+	uint32_t type;   // bot_cmd_type
+	uint32_t arg;    // MOVE: dir_t, NEW_GAME: random seed
+
+}bot_cmd;
+
+typedef struct bot_state{
+
+	uint64_t seq;        // number of commands answered, this one included
+	uint64_t board;      // packed board, see board.h
+	uint32_t score;
+	uint8_t  moved;      // the command changed the board
+	uint8_t  legal;      // bit n set if dir_t n would change the board
+	uint8_t  game_over;
+	uint8_t  pad;
+
+}bot_state;
+
+// head and tail on their own cache lines, each written by one side only
+typedef struct bot_ring{
+
+	_Alignas(64) _Atomic uint64_t head;  // written by the producer
+	_Alignas(64) _Atomic uint64_t tail;  // written by the consumer
+
+}bot_ring;
+
+typedef struct bot_shm{
+
+	uint32_t         magic;
+	uint32_t         version;
+	uint32_t         cols, rows;
+	uint32_t         pid;       // engine's, so a later one can tell a live segment from a stale one
+	_Atomic uint32_t ready;     // set by the engine once the rings are usable
+
+	bot_ring         cmd_ring;  // bot -> engine
+	bot_cmd          cmds[BOT_RING_SIZE];
+
+	bot_ring         state_ring; // engine -> bot
+	bot_state        states[BOT_RING_SIZE];
+
+}bot_shm;
+
+// Return: false if the ring is full
+static inline bool bot_ring_push(bot_ring* r, void* slots, size_t size, const void* item){
+
+	uint64_t h = atomic_load_explicit(&r->head, memory_order_relaxed);
+	if(h - atomic_load_explicit(&r->tail, memory_order_acquire) == BOT_RING_SIZE) return false;
+
+	memcpy((char*)slots + (h & BOT_RING_MASK) * size, item, size);
+	atomic_store_explicit(&r->head, h + 1, memory_order_release);
+	return true;
+}
+
+// Return: false if the ring is empty
+static inline bool bot_ring_pop(bot_ring* r, const void* slots, size_t size, void* item){
+
+	uint64_t t = atomic_load_explicit(&r->tail, memory_order_relaxed);
+	if(t == atomic_load_explicit(&r->head, memory_order_acquire)) return false;
+
+	memcpy(item, (const char*)slots + (t & BOT_RING_MASK) * size, size);
+	atomic_store_explicit(&r->tail, t + 1, memory_order_release);
+	return true;
+}
+
+#define BOT_SPINS  128   // busy-wait this long,
+#define BOT_YIELDS 1024  // then yield the core this many times, then sleep
+
+// back off while waiting on the other side: spin briefly, then give up the core,
+// then sleep (doubling up to ~1ms) so that a side left waiting on a dead peer idles
+static inline void bot_relax(unsigned* spins){
+
+	unsigned n = ++*spins;
+
+	if(n < BOT_SPINS){
+#if defined(__x86_64__) || defined(__i386__)
+		__builtin_ia32_pause();
+#endif
+	}else if(n < BOT_SPINS + BOT_YIELDS){
+		sched_yield();
+	}else{
+		unsigned k = n - BOT_SPINS - BOT_YIELDS;
+		struct timespec ts = { .tv_sec = 0, .tv_nsec = 1000L << (k < 10 ? k : 10) };
+		nanosleep(&ts, NULL);
+	}
+}
+
+#endif
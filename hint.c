@@ -0,0 +1,89 @@
+#include <pthread.h>
+
+#include "hint.h"
+
+#define HINT_TT_BITS 22  // 4M entries, 64MB
+
+static pthread_t       worker;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  wake = PTHREAD_COND_INITIALIZER;
+
+static atomic_uint     generation;  // bumped on every post/cancel, the search watches it
+static board_t         position;    // guarded by lock
+static bool            have_position;
+static search_result   published;   // guarded by lock
+static bool            have_result;
+
+static void* hint_worker(void* arg){
+
+	search_ctx* s = arg;
+	unsigned searched = 0;
+
+	while(1){
+
+		pthread_mutex_lock(&lock);
+		while(!have_position || atomic_load(&generation) == searched){ pthread_cond_wait(&wake, &lock); }
+		unsigned gen = atomic_load(&generation);
+		board_t b = position;
+		pthread_mutex_unlock(&lock);
+
+		searched = gen;
+		search_watch(s, &generation, gen);
+
+		for(int depth = 1; depth <= HINT_MAX_DEPTH; depth++){
+
+			search_result r;
+			if(!search_position(s, b, depth, &r)) break;
+
+			pthread_mutex_lock(&lock);
+			bool current = (atomic_load(&generation) == gen);
+			if(current){ published = r; have_result = true; }
+			pthread_mutex_unlock(&lock);
+
+			if(!current || r.best_move < 0) break;
+		}
+	}
+	return NULL;
+}
+
+bool hint_start(void){
+
+	search_ctx* s = search_new(HINT_TT_BITS);
+	if(!s) return false;
+
+	if(pthread_create(&worker, NULL, hint_worker, s)){
+		search_free(s);
+		return false;
+	}
+	pthread_detach(worker);
+	return true;
+}
+
+void hint_post(board_t b){
+
+	pthread_mutex_lock(&lock);
+	position = b;
+	have_position = true;
+	have_result = false;
+	atomic_fetch_add(&generation, 1);
+	pthread_cond_signal(&wake);
+	pthread_mutex_unlock(&lock);
+}
+
+void hint_cancel(void){
+
+	pthread_mutex_lock(&lock);
+	have_position = false;
+	have_result = false;
+	atomic_fetch_add(&generation, 1);
+	pthread_mutex_unlock(&lock);
+}
+
+bool hint_get(search_result* r){
+
+	pthread_mutex_lock(&lock);
+	bool ok = have_result;
+	if(ok) *r = published;
+	pthread_mutex_unlock(&lock);
+	return ok;
+}
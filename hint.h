@@ -0,0 +1,29 @@
+#ifndef HINT_H
+#define HINT_H
+
+#include <stdbool.h>
+
+#include "board.h"
+#include "search.h"
+
+/***********************************************************************
+
+ Background hint engine
+
+ A worker thread searches the position on screen, deepening one ply at a time,
+ while the player thinks. Each completed depth is published at once, so asking
+ for a hint never waits on the search. Posting a new position (or cancelling)
+ stops the current search at its next check; the worker keeps its
+ transposition table, so the part of the old tree the player actually went
+ down is not searched again.
+
+***********************************************************************/
+
+#define HINT_MAX_DEPTH 8
+
+bool hint_start(void);             // Return: false if the worker could not be started
+void hint_post(board_t b);         // search this position from now on
+void hint_cancel(void);            // stop searching, nothing to look at
+bool hint_get(search_result* r);   // Return: false until depth 1 of the current position is done
+
+#endif
@@ -0,0 +1,147 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "search.h"
+
+#define P_SPAWN_2   0.9     // as insert_new_tile()
+#define MIN_PROB    1e-4    // chance nodes less likely than this are not explored
+#define CHECK_EVERY 1024    // nodes between looks at the cancel flag
+
+typedef struct tt_entry{
+
+	board_t  key;    // after-state, canonical
+	float    value;
+	uint16_t gen;    // search_forget() generation the entry belongs to
+	uint8_t  depth;  // 0: empty slot
+
+}tt_entry;
+
+struct search_ctx{
+
+	tt_entry*          tt;
+	uint64_t           tt_mask;
+	int                tt_shift;
+	uint16_t           gen;
+
+	const atomic_uint* watch;
+	unsigned           expect;
+	bool               cancelled;
+	long               nodes;
+
+};
+
+search_ctx* search_new(unsigned tt_bits){
+
+	search_ctx* s = calloc(1, sizeof(*s));
+	if(!s) return NULL;
+
+	s->tt = calloc((size_t)1 << tt_bits, sizeof(tt_entry));
+	if(!s->tt){ free(s); return NULL; }
+	s->tt_mask = ((uint64_t)1 << tt_bits) - 1;
+	s->tt_shift = 64 - (int)tt_bits;
+	return s;
+}
+
+void search_free(search_ctx* s){
+
+	if(!s) return;
+	free(s->tt);
+	free(s);
+}
+
+void search_forget(search_ctx* s){
+
+	// once the generation wraps, entries from 64K searches ago would look current
+	if(++s->gen == 0) memset(s->tt, 0, (s->tt_mask + 1) * sizeof(tt_entry));
+}
+
+void search_watch(search_ctx* s, const atomic_uint* watch, unsigned expect){
+
+	s->watch = watch;
+	s->expect = expect;
+}
+
+static inline tt_entry* tt_slot(search_ctx* s, board_t b){
+
+	return &s->tt[((b * 0x9E3779B97F4A7C15ull) >> s->tt_shift) & s->tt_mask];
+}
+
+static double chance_node(search_ctx* s, board_t a, int depth, double prob);
+
+// player to move: best of the legal moves
+static double max_node(search_ctx* s, board_t b, int depth, double prob){
+
+	double best = 0.0;
+	unsigned legal = board_legal_moves(b);
+
+	for(int dir = 0; dir < N_DIRS; dir++){
+
+		if(!(legal & (1u << dir))) continue;
+
+		uint32_t points;
+		board_t a = board_move(b, dir, &points);
+
+		double v = points + chance_node(s, a, depth - 1, prob);
+		if(v > best) best = v;
+	}
+	return best;
+}
+
+// tile about to spawn: average over every empty cell and both values
+static double chance_node(search_ctx* s, board_t a, int depth, double prob){
+
+	if(depth <= 0 || prob < MIN_PROB || s->cancelled) return 0.0;
+
+	if((++s->nodes % CHECK_EVERY) == 0 && s->watch
+	   && atomic_load_explicit(s->watch, memory_order_relaxed) != s->expect){
+		s->cancelled = true;
+		return 0.0;
+	}
+
+	board_t key = board_canonical(a, NULL);  // symmetric positions share an entry
+	tt_entry* e = tt_slot(s, key);
+	if(e->key == key && e->depth == depth && e->gen == s->gen) return e->value;  // value is points over exactly depth moves
+
+	int n_empty = board_count_empty(a);
+	double total = 0.0;
+
+	for(int i = 0; i < N_CELLS; i++){
+		if((a >> (4 * i)) & 0xF) continue;
+		total += P_SPAWN_2 * max_node(s, a | ((board_t)1 << (4 * i)), depth, prob * P_SPAWN_2 / n_empty);
+		total += (1.0 - P_SPAWN_2) * max_node(s, a | ((board_t)2 << (4 * i)), depth, prob * (1.0 - P_SPAWN_2) / n_empty);
+	}
+	total /= n_empty;
+
+	if(!s->cancelled){
+		e->key = key;
+		e->value = (float)total;
+		e->gen = s->gen;
+		e->depth = (uint8_t)depth;
+	}
+	return total;
+}
+
+bool search_position(search_ctx* s, board_t b, int depth, search_result* r){
+
+	s->cancelled = false;
+	s->nodes = 0;
+
+	r->best_move = -1;
+	r->depth = depth;
+
+	unsigned legal = board_legal_moves(b);
+
+	for(int dir = 0; dir < N_DIRS; dir++){
+
+		r->value[dir] = -1.0;
+		if(!(legal & (1u << dir))) continue;
+
+		uint32_t points;
+		board_t a = board_move(b, dir, &points);
+
+		r->value[dir] = points + chance_node(s, a, depth - 1, 1.0);
+		if(r->best_move < 0 || r->value[dir] > r->value[r->best_move]) r->best_move = dir;
+	}
+	r->nodes = s->nodes;
+	return !s->cancelled;
+}
@@ -0,0 +1,47 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+
+#include "board.h"
+
+/***********************************************************************
+
+ Expectimax search
+
+ Value of a position = expected points scored over the next 'depth' moves
+ with best play, spawns as insert_new_tile(). A search context owns its
+ transposition table, so keep one per thread; entries stay valid from one
+ search to the next, which is what makes re-searching a successor cheap,
+ unless search_forget() drops them. Ties between moves go to the first in
+ dir_t order.
+
+***********************************************************************/
+
+#define SEARCH_MAX_DEPTH 255  // the table keeps depth in a byte
+
+typedef struct search_ctx search_ctx;
+
+typedef struct search_result{
+
+	int    best_move;        // dir_t, -1 if there are no legal moves
+	double value[N_DIRS];    // per move, negative if the move is illegal
+	int    depth;
+	long   nodes;
+
+}search_result;
+
+search_ctx* search_new(unsigned tt_bits);  // table of 2^tt_bits entries
+void        search_free(search_ctx* s);
+
+// drop every table entry, so the next search depends on its position alone
+void        search_forget(search_ctx* s);
+
+// give up as soon as *watch no longer equals expect (cooperative cancel)
+void        search_watch(search_ctx* s, const atomic_uint* watch, unsigned expect);
+
+// Return: false if cancelled before the search completed
+bool        search_position(search_ctx* s, board_t b, int depth, search_result* r);
+
+#endif
@@ -0,0 +1,449 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "board.h"
+#include "table.h"
+
+/***********************************************************************
+
+ 2048 solver for small boards
+
+ Enumerates every position reachable on an N_COLS x N_ROWS board and works
+ out, by retrograde analysis, the expected points still to come under optimal
+ play. Build once per board size (see CMakeLists.txt).
+
+ Each move preserves the tile sum and each spawn adds 2 or 4 to it, so the
+ game graph is layered by tile sum and has no cycles:
+
+   forward:  layer by layer in increasing sum, expand every position into its
+             successors. Successors collect in a fixed size buffer which is
+             sorted, deduplicated and spilled to disk as a run whenever it
+             fills; a layer's runs are merged into one sorted, duplicate free
+             file just before it is expanded in turn.
+
+   backward: layer by layer in decreasing sum, value each position from the
+             (already valued, mmapped) layers sum+2 and sum+4.
+
+ Only the spill buffer is held in RAM, everything else streams. Positions are
+ stored as their canonical symmetric copy (board_canonical()), which cuts every
+ layer, and the final table, by up to 8x.
+
+ usage: 2048-solve [-m MB] [-d workdir] [-o table]
+
+***********************************************************************/
+
+#define P_SPAWN_2   0.9  // as insert_new_tile()
+#define MAX_SUM     ((uint32_t)N_CELLS << MAX_TILE)
+#define MAX_RUNS    4096
+
+static const char* work_dir = ".";
+
+static board_t* buf;       // spill buffer
+static size_t   buf_cap;
+static size_t   buf_n;
+
+typedef struct layer_info{
+
+	int      n_runs;
+	uint64_t count;   // distinct positions, known once merged
+
+}layer_info;
+
+static layer_info* layers;  // indexed by sum / 2
+static uint32_t    max_sum; // highest sum seen so far
+
+static void die(const char* s){
+
+	perror(s);
+	exit(1);
+}
+
+static void layer_path(char* out, size_t sz, uint32_t sum, const char* kind, int k){
+
+	if(k < 0) snprintf(out, sz, "%s/L%06u.%s", work_dir, sum, kind);
+	else      snprintf(out, sz, "%s/L%06u.%s%d", work_dir, sum, kind, k);
+}
+
+static int cmp_board(const void* a, const void* b){
+
+	board_t x = *(const board_t*)a, y = *(const board_t*)b;
+	return (x > y) - (x < y);
+}
+
+/***********************************************************************
+
+ spill()
+
+ Sort and deduplicate the buffer, then append each position to a new run
+ for its layer. A sorted buffer split by layer leaves every run sorted.
+
+***********************************************************************/
+
+static void spill(void){
+
+	struct { uint32_t sum; FILE* fh; } open_runs[8];
+	int n_open = 0;
+	char path[4096];
+
+	if(buf_n == 0) return;
+
+	qsort(buf, buf_n, sizeof(buf[0]), cmp_board);
+
+	for(size_t i = 0; i < buf_n; i++){
+
+		if(i && buf[i] == buf[i-1]) continue;
+
+		uint32_t sum = board_tile_sum(buf[i]);
+		int k;
+		for(k = 0; k < n_open && open_runs[k].sum != sum; k++);
+
+		if(k == n_open){
+			// successors are at most 2 layers ahead, seeds 3: never more than a handful open
+			if(n_open == (int)(sizeof(open_runs) / sizeof(open_runs[0]))){ fprintf(stderr, "too many layers in one spill\n"); exit(1); }
+			if(layers[sum / 2].n_runs == MAX_RUNS){ fprintf(stderr, "too many runs, raise -m\n"); exit(1); }
+			layer_path(path, sizeof(path), sum, "run", layers[sum / 2].n_runs++);
+			open_runs[k].sum = sum;
+			open_runs[k].fh = fopen(path, "wb");
+			if(!open_runs[k].fh) die(path);
+			n_open++;
+		}
+		if(fwrite(&buf[i], sizeof(buf[i]), 1, open_runs[k].fh) != 1) die("write run");
+	}
+
+	for(int k = 0; k < n_open; k++){ if(fclose(open_runs[k].fh)) die("close run"); }
+	buf_n = 0;
+}
+
+static void emit(board_t b){
+
+	uint32_t sum = board_tile_sum(b);
+	if(sum > max_sum) max_sum = sum;
+
+	if(buf_n == buf_cap) spill();
+	buf[buf_n++] = board_canonical(b, NULL);
+}
+
+/***********************************************************************
+
+ merge_layer()
+
+ k-way merge of a layer's runs, dropping duplicates, into its .states file
+
+ Return: number of distinct positions in the layer
+
+***********************************************************************/
+
+typedef struct run_head{
+
+	board_t key;
+	FILE*   fh;
+
+}run_head;
+
+static void heap_down(run_head* h, int n, int i){
+
+	while(1){
+		int l = 2 * i + 1, r = l + 1, m = i;
+		if(l < n && h[l].key < h[m].key) m = l;
+		if(r < n && h[r].key < h[m].key) m = r;
+		if(m == i) return;
+		run_head t = h[i]; h[i] = h[m]; h[m] = t;
+		i = m;
+	}
+}
+
+static uint64_t merge_layer(uint32_t sum){
+
+	layer_info* L = &layers[sum / 2];
+	run_head heap[MAX_RUNS];
+	char path[4096];
+	int n = 0;
+
+	for(int k = 0; k < L->n_runs; k++){
+		layer_path(path, sizeof(path), sum, "run", k);
+		FILE* fh = fopen(path, "rb");
+		if(!fh) die(path);
+		unlink(path); // gone once closed
+		if(fread(&heap[n].key, sizeof(board_t), 1, fh) == 1){ heap[n++].fh = fh; }
+		else fclose(fh);
+	}
+	L->n_runs = 0;
+	L->count = 0;
+	if(n == 0) return 0;
+
+	for(int i = n / 2 - 1; i >= 0; i--) heap_down(heap, n, i);
+
+	layer_path(path, sizeof(path), sum, "states", -1);
+	FILE* out = fopen(path, "wb");
+	if(!out) die(path);
+
+	board_t last = 0;
+	while(n){
+		if(L->count == 0 || heap[0].key != last){
+			last = heap[0].key;
+			if(fwrite(&last, sizeof(last), 1, out) != 1) die("write states");
+			L->count++;
+		}
+		if(fread(&heap[0].key, sizeof(board_t), 1, heap[0].fh) != 1){
+			fclose(heap[0].fh);
+			heap[0] = heap[--n];
+		}
+		heap_down(heap, n, 0);
+	}
+	if(fclose(out)) die("close states");
+	return L->count;
+}
+
+// every position reachable in one move + spawn from each position in the layer
+static void expand_layer(uint32_t sum){
+
+	char path[4096];
+	board_t b;
+
+	layer_path(path, sizeof(path), sum, "states", -1);
+	FILE* fh = fopen(path, "rb");
+	if(!fh) die(path);
+
+	while(fread(&b, sizeof(b), 1, fh) == 1){
+
+		unsigned legal = board_legal_moves(b);
+
+		for(int dir = 0; dir < N_DIRS; dir++){
+
+			if(!(legal & (1u << dir))) continue;
+
+			board_t a = board_move(b, dir, NULL);
+
+			for(int i = 0; i < N_CELLS; i++){
+				if((a >> (4 * i)) & 0xF) continue;
+				emit(a | ((board_t)1 << (4 * i)));
+				emit(a | ((board_t)2 << (4 * i)));
+			}
+		}
+	}
+	fclose(fh);
+}
+
+/***********************************************************************
+
+ Backward pass
+
+***********************************************************************/
+
+typedef struct value_map{
+
+	const table_entry* e;
+	size_t             n;
+	size_t             size;
+
+}value_map;
+
+static void map_values(value_map* m, uint32_t sum){
+
+	char path[4096];
+	struct stat st;
+
+	memset(m, 0, sizeof(*m));
+	if(sum > MAX_SUM || layers[sum / 2].count == 0) return;
+
+	layer_path(path, sizeof(path), sum, "values", -1);
+	int fd = open(path, O_RDONLY);
+	if(fd < 0 || fstat(fd, &st) < 0) die(path);
+	void* p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if(p == MAP_FAILED) die("mmap values");
+
+	m->e = p;
+	m->size = (size_t)st.st_size;
+	m->n = m->size / sizeof(table_entry);
+}
+
+static void unmap_values(value_map* m){
+
+	if(m->e) munmap((void*)m->e, m->size);
+}
+
+static double value_of(const value_map* m, board_t b){
+
+	size_t lo = 0, hi = m->n;
+
+	b = board_canonical(b, NULL);
+	while(lo < hi){
+		size_t mid = (lo + hi) / 2;
+		if(m->e[mid].key < b) lo = mid + 1; else hi = mid;
+	}
+	if(lo == m->n || m->e[lo].key != b){
+		fprintf(stderr, "successor %016llx missing from its layer\n", (unsigned long long)b);
+		exit(1);
+	}
+	return m->e[lo].value;
+}
+
+static void value_layer(uint32_t sum){
+
+	char path[4096];
+	value_map next2, next4;
+	board_t b;
+
+	map_values(&next2, sum + 2);
+	map_values(&next4, sum + 4);
+
+	layer_path(path, sizeof(path), sum, "states", -1);
+	FILE* in = fopen(path, "rb");
+	if(!in) die(path);
+	unlink(path);
+
+	layer_path(path, sizeof(path), sum, "values", -1);
+	FILE* out = fopen(path, "wb");
+	if(!out) die(path);
+
+	while(fread(&b, sizeof(b), 1, in) == 1){
+
+		table_entry e = { .key = b, .value = 0.0f, .best_move = NO_MOVE };
+		double best = 0.0;
+		unsigned legal = board_legal_moves(b);
+
+		for(int dir = 0; dir < N_DIRS; dir++){
+
+			if(!(legal & (1u << dir))) continue;
+
+			uint32_t points;
+			board_t a = board_move(b, dir, &points);
+
+			double total = 0.0;
+			int n_empty = 0;
+			for(int i = 0; i < N_CELLS; i++){
+				if((a >> (4 * i)) & 0xF) continue;
+				total += P_SPAWN_2 * value_of(&next2, a | ((board_t)1 << (4 * i)));
+				total += (1.0 - P_SPAWN_2) * value_of(&next4, a | ((board_t)2 << (4 * i)));
+				n_empty++;
+			}
+
+			double v = points + total / n_empty;
+			if(e.best_move == NO_MOVE || v > best){
+				best = v;
+				e.best_move = (uint8_t)dir;
+			}
+		}
+		e.value = (float)best;
+		if(fwrite(&e, sizeof(e), 1, out) != 1) die("write values");
+	}
+
+	fclose(in);
+	if(fclose(out)) die("close values");
+	unmap_values(&next2);
+	unmap_values(&next4);
+}
+
+// stitch the per-layer value files together behind a header and layer index
+static void write_table(const char* out_path){
+
+	table_header h = { .magic = TABLE_MAGIC, .cols = N_COLS, .rows = N_ROWS };
+	table_entry e;
+	char path[4096];
+	uint64_t first = 0;
+	uint64_t total = 0;
+
+	for(uint32_t sum = 2; sum <= max_sum; sum += 2){ if(layers[sum / 2].count) h.n_layers++; }
+
+	FILE* out = fopen(out_path, "wb");
+	if(!out) die(out_path);
+	if(fwrite(&h, sizeof(h), 1, out) != 1) die("write table");
+
+	for(uint32_t sum = 2; sum <= max_sum; sum += 2){
+		if(!layers[sum / 2].count) continue;
+		table_layer l = { .sum = sum, .first = first, .count = layers[sum / 2].count };
+		if(fwrite(&l, sizeof(l), 1, out) != 1) die("write table");
+		first += l.count;
+	}
+
+	for(uint32_t sum = 2; sum <= max_sum; sum += 2){
+		if(!layers[sum / 2].count) continue;
+		layer_path(path, sizeof(path), sum, "values", -1);
+		FILE* in = fopen(path, "rb");
+		if(!in) die(path);
+		while(fread(&e, sizeof(e), 1, in) == 1){
+			if(fwrite(&e, sizeof(e), 1, out) != 1) die("write table");
+			total++;
+		}
+		fclose(in);
+		unlink(path);
+	}
+	if(fclose(out)) die("close table");
+
+	fprintf(stderr, "%s: %llu positions in %u layers\n", out_path, (unsigned long long)total, h.n_layers);
+}
+
+int main(int argc, char** argv){
+
+	char default_out[64];
+	const char* out_path = default_out;
+	size_t ram_mb = 256;
+	int opt;
+
+	snprintf(default_out, sizeof(default_out), "solved-%dx%d.tbl", N_COLS, N_ROWS);
+
+	while((opt = getopt(argc, argv, "m:d:o:")) != -1){
+		switch(opt){
+			case 'm': ram_mb = (size_t)strtoul(optarg, NULL, 10); break;
+			case 'd': work_dir = optarg; break;
+			case 'o': out_path = optarg; break;
+			default:
+			fprintf(stderr, "usage: %s [-m MB] [-d workdir] [-o table]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	board_init();
+
+	buf_cap = (ram_mb << 20) / sizeof(board_t);
+	if(buf_cap < 1024) buf_cap = 1024;
+	buf = malloc(buf_cap * sizeof(board_t));
+	layers = calloc(MAX_SUM / 2 + 3, sizeof(layer_info));
+	if(!buf || !layers) die("malloc");
+
+	// opening positions: two tiles on an empty board
+	for(int i = 0; i < N_CELLS; i++){
+		for(int j = i + 1; j < N_CELLS; j++){
+			for(int vi = 1; vi <= 2; vi++){
+				for(int vj = 1; vj <= 2; vj++){
+					emit(((board_t)vi << (4 * i)) | ((board_t)vj << (4 * j)));
+				}
+			}
+		}
+	}
+
+	uint64_t reached = 0;
+	for(uint32_t sum = 2; sum <= max_sum; sum += 2){
+
+		if(layers[sum / 2].n_runs == 0 && buf_n == 0) continue;
+		spill();
+
+		uint64_t n = merge_layer(sum);
+		if(n == 0) continue;
+
+		reached += n;
+		fprintf(stderr, "\rforward  sum %6u: %12llu positions (%llu total)", sum, (unsigned long long)n, (unsigned long long)reached);
+		expand_layer(sum);
+	}
+	fprintf(stderr, "\n");
+	free(buf);
+
+	for(uint32_t sum = max_sum; sum >= 2; sum -= 2){
+
+		if(!layers[sum / 2].count) continue;
+		fprintf(stderr, "\rbackward sum %6u", sum);
+		value_layer(sum);
+	}
+	fprintf(stderr, "\n");
+
+	write_table(out_path);
+
+	free(layers);
+	return 0;
+}
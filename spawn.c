@@ -0,0 +1,201 @@
+#include <string.h>
+#include <time.h>
+
+#include "spawn.h"
+
+long spawn_budget_us = SPAWN_BUDGET_US;
+
+// as insert_new_tile() always did: any empty cell, a 2 nine times in ten
+bool spawn_random(board_t b, uint64_t rnd, spawn_choice* c){
+
+	int n_empty = board_count_empty(b);
+	if(n_empty == 0) return false;
+
+	int k = (int)((rnd / 10) % (uint64_t)n_empty);
+	c->value = (rnd % 10) ? 1 : 2;
+
+	for(int i = 0; i < N_CELLS; i++){
+		if((b >> (4 * i)) & 0xF) continue;
+		if(k-- == 0){ c->cell = i; break; }
+	}
+	return true;
+}
+
+/***********************************************************************
+
+ Adversary
+
+ Minimax over player moves (max) and spawns (min). Scores are points the
+ player collects along the line, plus, at the horizon, a bonus for room to
+ manoeuvre; running out of moves costs DEAD. Children are tried best-first for
+ the side to move so alpha-beta cuts early: player moves by points scored,
+ spawns by how little they leave the player to work with.
+
+***********************************************************************/
+
+#define EMPTY_BONUS  64    // per empty cell at the horizon
+#define PAIR_BONUS   32    // per pair of equal neighbours at the horizon
+#define DEAD         (1 << 24)
+#define INF          (1 << 30)
+#define MAX_DEPTH    16
+#define CHECK_EVERY  256   // nodes between looks at the clock
+
+static struct adversary{
+
+	struct timespec deadline;
+	bool            out_of_time;
+	long            nodes;
+
+}adv;
+
+static bool past_deadline(void){
+
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec > adv.deadline.tv_sec || (now.tv_sec == adv.deadline.tv_sec && now.tv_nsec >= adv.deadline.tv_nsec);
+}
+
+// equal, non-empty neighbours: merges waiting to happen
+static int count_pairs(board_t b){
+
+	int n = 0;
+	for(int row = 0; row < N_ROWS; row++){
+		for(int col = 0; col < N_COLS; col++){
+			int v = board_get(b, col, row);
+			if(!v) continue;
+			if(col + 1 < N_COLS && board_get(b, col + 1, row) == v) n++;
+			if(row + 1 < N_ROWS && board_get(b, col, row + 1) == v) n++;
+		}
+	}
+	return n;
+}
+
+static int room(board_t b){
+
+	return EMPTY_BONUS * board_count_empty(b) + PAIR_BONUS * count_pairs(b);
+}
+
+static int min_spawn(board_t a, int depth, int alpha, int beta);
+
+// player to move
+static int max_move(board_t b, int depth, int alpha, int beta){
+
+	board_t  next[N_DIRS];
+	uint32_t points[N_DIRS];
+	int      order[N_DIRS];
+	int      n = 0;
+	unsigned legal = board_legal_moves(b);
+
+	if(depth == 0) return legal ? room(b) : -DEAD;
+
+	for(int dir = 0; dir < N_DIRS; dir++){
+		if(!(legal & (1u << dir))) continue;
+		next[n] = board_move(b, dir, &points[n]);
+		// insertion sort, most points first
+		int k = n++;
+		while(k > 0 && points[order[k-1]] < points[k]){ order[k] = order[k-1]; k--; }
+		order[k] = n - 1;
+	}
+	if(n == 0) return -DEAD;
+
+	int best = -INF;
+	for(int i = 0; i < n && !adv.out_of_time; i++){
+		int v = (int)points[order[i]] + min_spawn(next[order[i]], depth - 1, alpha - (int)points[order[i]], beta - (int)points[order[i]]);
+		if(v > best) best = v;
+		if(best > alpha) alpha = best;
+		if(alpha >= beta) break;
+	}
+	return best;
+}
+
+typedef struct spawn_option{
+
+	board_t board;
+	int     key;      // ordering: lower is worse for the player, tried first
+	int     cell, value;
+
+}spawn_option;
+
+static int list_spawns(board_t a, spawn_option* opts){
+
+	int n = 0;
+	for(int i = 0; i < N_CELLS; i++){
+		if((a >> (4 * i)) & 0xF) continue;
+		for(int v = 1; v <= 2; v++){
+			spawn_option o = { .board = a | ((board_t)v << (4 * i)), .cell = i, .value = v };
+			o.key = room(o.board);
+			int k = n++;
+			while(k > 0 && opts[k-1].key > o.key){ opts[k] = opts[k-1]; k--; }
+			opts[k] = o;
+		}
+	}
+	return n;
+}
+
+// tile to place: the adversary takes the worst case for the player
+static int min_spawn(board_t a, int depth, int alpha, int beta){
+
+	spawn_option opts[2 * N_CELLS];
+
+	if((++adv.nodes % CHECK_EVERY) == 0 && past_deadline()){ adv.out_of_time = true; }
+	if(adv.out_of_time) return 0;
+
+	int n = list_spawns(a, opts);
+	int best = INF;
+	for(int i = 0; i < n && !adv.out_of_time; i++){
+		int v = max_move(opts[i].board, depth, alpha, beta);
+		if(v < best) best = v;
+		if(best < beta) beta = best;
+		if(alpha >= beta) break;
+	}
+	return best;
+}
+
+bool spawn_adversary(board_t b, uint64_t rnd, spawn_choice* c){
+
+	spawn_option opts[2 * N_CELLS];
+	struct timespec now;
+
+	int n = list_spawns(b, opts);
+	if(n == 0) return false;
+
+	(void)rnd;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	adv.deadline.tv_sec = now.tv_sec + (now.tv_nsec / 1000 + spawn_budget_us) / 1000000;
+	adv.deadline.tv_nsec = ((now.tv_nsec / 1000 + spawn_budget_us) % 1000000) * 1000;
+	adv.out_of_time = false;
+	adv.nodes = 0;
+
+	// best guess until a search completes: the statically nastiest spawn
+	c->cell = opts[0].cell;
+	c->value = opts[0].value;
+
+	// iterative deepening: each completed depth re-orders the root for the next
+	for(int depth = 1; depth <= MAX_DEPTH; depth++){
+
+		int best = INF, best_i = 0;
+		for(int i = 0; i < n; i++){
+			int v = max_move(opts[i].board, depth, -INF, best);
+			if(adv.out_of_time) break;
+			if(v < best){ best = v; best_i = i; }
+		}
+		if(adv.out_of_time) break;
+
+		c->cell = opts[best_i].cell;
+		c->value = opts[best_i].value;
+		if(best < -DEAD / 2) break;  // a forced loss: nothing deeper to find
+
+		// most damaging first next time round
+		spawn_option chosen = opts[best_i];
+		memmove(&opts[1], &opts[0], (size_t)best_i * sizeof(opts[0]));
+		opts[0] = chosen;
+	}
+	return true;
+}
+
+spawn_policy spawn_policy_named(const char* name){
+
+	if(!strcmp(name, "random"))    return spawn_random;
+	if(!strcmp(name, "adversary")) return spawn_adversary;
+	return NULL;
+}
@@ -0,0 +1,39 @@
+#ifndef SPAWN_H
+#define SPAWN_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "board.h"
+
+/***********************************************************************
+
+ Spawn policies
+
+ Decide where the tile after each move goes, and whether it is a 2 or a 4.
+ 'random' is the real game. 'adversary' is a stress test: it places the tile
+ that leaves the player worst off, by depth-limited minimax with alpha-beta
+ pruning, deepening until spawn_budget_us runs out.
+
+***********************************************************************/
+
+typedef struct spawn_choice{
+
+	int cell;    // col + row * N_COLS
+	int value;   // log2: 1 or 2
+
+}spawn_choice;
+
+// rnd: fresh random bits from the caller, for policies that want them
+// Return: false if the board has no empty cell
+typedef bool (*spawn_policy)(board_t b, uint64_t rnd, spawn_choice* c);
+
+bool         spawn_random(board_t b, uint64_t rnd, spawn_choice* c);
+bool         spawn_adversary(board_t b, uint64_t rnd, spawn_choice* c);
+spawn_policy spawn_policy_named(const char* name);  // NULL if there is no such policy
+
+#define SPAWN_BUDGET_US 10000  // inside one 60Hz frame
+
+extern long spawn_budget_us;
+
+#endif
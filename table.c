@@ -0,0 +1,131 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "table.h"
+
+struct table{
+
+	void*              map;
+	size_t             size;
+	const table_layer* layers;
+	uint32_t           n_layers;
+	const table_entry* entries;
+
+};
+
+/***********************************************************************
+
+ table_open()
+
+ Map a solved-position table. Nothing is read up front, pages come in as
+ lookups touch them.
+
+ Return: the table, or NULL (with a message on stderr) if it is missing,
+         damaged or was solved for a different board size
+
+***********************************************************************/
+
+table* table_open(const char* path){
+
+	struct stat st;
+	int fd = open(path, O_RDONLY);
+	if(fd < 0){ perror(path); return NULL; }
+
+	if(fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(table_header)){
+		fprintf(stderr, "%s: not a solved table\n", path);
+		close(fd);
+		return NULL;
+	}
+
+	void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if(map == MAP_FAILED){ perror("mmap"); return NULL; }
+
+	const table_header* h = map;
+	size_t need = sizeof(*h) + (size_t)h->n_layers * sizeof(table_layer);
+
+	if(memcmp(h->magic, TABLE_MAGIC, sizeof(h->magic)) || (size_t)st.st_size < need){
+		fprintf(stderr, "%s: not a solved table\n", path);
+		munmap(map, (size_t)st.st_size);
+		return NULL;
+	}
+	if(h->cols != N_COLS || h->rows != N_ROWS){
+		fprintf(stderr, "%s: solved for %ux%u, this build is %dx%d\n", path, h->cols, h->rows, N_COLS, N_ROWS);
+		munmap(map, (size_t)st.st_size);
+		return NULL;
+	}
+
+	// every layer must lie within the entries actually present, in the order lookups assume
+	const table_layer* layers = (const table_layer*)(h + 1);
+	uint64_t n_entries = ((size_t)st.st_size - need) / sizeof(table_entry);
+
+	for(uint32_t i = 0; i < h->n_layers; i++){
+		if(layers[i].first > n_entries || layers[i].count > n_entries - layers[i].first
+		   || (i > 0 && layers[i].sum <= layers[i - 1].sum)){
+			fprintf(stderr, "%s: damaged table (layer %u)\n", path, i);
+			munmap(map, (size_t)st.st_size);
+			return NULL;
+		}
+	}
+
+	table* t = calloc(1, sizeof(*t));
+	if(!t){ munmap(map, (size_t)st.st_size); return NULL; }
+
+	t->map = map;
+	t->size = (size_t)st.st_size;
+	t->n_layers = h->n_layers;
+	t->layers = layers;
+	t->entries = (const table_entry*)(t->layers + t->n_layers);
+	return t;
+}
+
+void table_close(table* t){
+
+	if(!t) return;
+	munmap(t->map, t->size);
+	free(t);
+}
+
+/***********************************************************************
+
+ table_lookup()
+
+ Find b's canonical copy in its tile-sum layer by binary search.
+
+ Return: true if b was reached by the solver, with *value and *best_move set
+
+***********************************************************************/
+
+bool table_lookup(const table* t, board_t b, float* value, int* best_move){
+
+	int sym;
+	uint32_t sum = board_tile_sum(b);
+
+	b = board_canonical(b, &sym);
+	size_t lo = 0, hi = t->n_layers;
+
+	// layers are written in order of increasing sum
+	while(lo < hi){
+		size_t mid = (lo + hi) / 2;
+		if(t->layers[mid].sum < sum) lo = mid + 1; else hi = mid;
+	}
+	if(lo == t->n_layers || t->layers[lo].sum != sum) return false;
+
+	const table_entry* e = t->entries + t->layers[lo].first;
+	size_t n = (size_t)t->layers[lo].count;
+	lo = 0, hi = n;
+	while(lo < hi){
+		size_t mid = (lo + hi) / 2;
+		if(e[mid].key < b) lo = mid + 1; else hi = mid;
+	}
+	if(lo == n || e[lo].key != b) return false;
+
+	if(value) *value = e[lo].value;
+	if(best_move) *best_move = (e[lo].best_move == NO_MOVE) ? -1 : sym_dir_to_real(sym, e[lo].best_move);
+	return true;
+}
@@ -0,0 +1,59 @@
+#ifndef TABLE_H
+#define TABLE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "board.h"
+
+/***********************************************************************
+
+ Solved-position table
+
+ Written by the solver (solver.c) for small boards, read back by the game.
+ Positions are grouped into layers by tile sum, since every move + spawn
+ adds exactly 2 or 4 to it, and each layer is sorted by packed board.
+ Only the canonical copy of each position is stored (see board_canonical()),
+ best_move being the move on that copy.
+
+ file:  table_header | table_layer[n_layers] | table_entry[...]
+
+***********************************************************************/
+
+#define TABLE_MAGIC "2048TBL2"
+#define NO_MOVE     0xFF  // best_move of a position with no legal moves
+
+typedef struct table_header{
+
+	char     magic[8];
+	uint32_t cols, rows;
+	uint32_t n_layers;
+	uint32_t reserved;
+
+}table_header;
+
+typedef struct table_layer{
+
+	uint32_t sum;      // tile sum shared by every position in the layer
+	uint32_t reserved;
+	uint64_t first;    // index of first entry
+	uint64_t count;
+
+}table_layer;
+
+typedef struct table_entry{
+
+	uint64_t key;       // packed board, canonical
+	float    value;     // expected points still to come under optimal play
+	uint8_t  best_move; // dir_t, or NO_MOVE
+	uint8_t  pad[3];
+
+}table_entry;
+
+typedef struct table table;
+
+table* table_open(const char* path);
+void   table_close(table* t);
+bool   table_lookup(const table* t, board_t b, float* value, int* best_move);
+
+#endif
@@ -7,8 +7,18 @@
 #include <errno.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <stddef.h>
 #include <fcntl.h>
 #include <stdarg.h>
+#include <sys/select.h>
+
+#include "board.h"
+#include "table.h"
+#include "hint.h"
+#include "analyze.h"
+#include "bot.h"
+#include "bench.h"
+#include "spawn.h"
 #include <stdio.h>
 
 #define _ESC_ \x1b
@@ -18,8 +28,6 @@
 #define _CUF_ C
 #define _CUB_ D
 
-#define N_COLS 4
-#define N_ROWS 4
 
 #define ESC "\x1b"
 
@@ -49,6 +57,9 @@ struct game{
    int     width;    // N_COLS
    int     height;   // N_ROWS
    FILE*   logfile;  // fh for logging
+   table*  solved;   // --table: optimal play, for boards small enough to solve
+   bool    hints;    // background hint engine is running
+   spawn_policy spawn; // --spawn: who decides where new tiles go
    
 }game;
 
@@ -198,6 +209,62 @@ void cursor_to(int x, int y){
 
 /************************************************
 
+pack_board()
+
+The game board as a packed board_t, display flags stripped
+
+************************************************/
+
+board_t pack_board(void){
+
+	board_t b = 0;
+
+	for(int col = 0; col < N_COLS; col++){
+		for(int row = 0; row < N_ROWS; row++){
+			int v = game.board[col][row] & ~INVERT;
+			b = board_set(b, col, row, (v > MAX_TILE) ? MAX_TILE : v);
+		}
+	}
+	return b;
+}
+
+// beneath the board: what the solved table says to do here
+void show_solved(void){
+
+	float value;
+	int best;
+
+	cursor_to(5 + 3 * N_ROWS, 1);
+	if(!table_lookup(game.solved, pack_board(), &value, &best)){
+		ffsprintf(f_out, "Optimal: position not in table");
+	}else if(best < 0){
+		ffsprintf(f_out, "Optimal: no moves left");
+	}else{
+		ffsprintf(f_out, "Optimal: %s (expect %.1f more)", dir_names[best], value);
+	}
+	ffsprintf(f_out, "\n\r");
+}
+
+// 'h' key: whatever the background search has come up with so far
+void show_hint(void){
+
+	search_result r;
+
+	cursor_to(6 + 3 * N_ROWS, 1);
+	if(!game.hints){
+		ffsprintf(f_out, "Hint: unavailable");
+	}else if(!hint_get(&r)){
+		ffsprintf(f_out, "Hint: thinking...");
+	}else if(r.best_move < 0){
+		ffsprintf(f_out, "Hint: no moves left");
+	}else{
+		ffsprintf(f_out, "Hint: %s (expect score %d within %d moves)", dir_names[r.best_move], game.score + (int)r.value[r.best_move], r.depth);
+	}
+	ffsprintf(f_out, ESC "[K\n\r");
+}
+
+/************************************************
+
 render(void)
 
 DIsplay the game board
@@ -230,21 +297,20 @@ void render(void){
 	cursor_to(1,1);
 
 	//top row
-	ffsprintf(f_out,  BORDER_COLOR "╔══════════════════════╗");
-	// ffsprintf(f_out,  BORDER_COLOR "\u2554\u2550");
-	// for(col = 0; col < game.width; col++){ ffsprintf(f_out, "\u2550\u2550\u2550\u2550\u2550"); }
-	// ffsprintf(f_out, "\u2550\u2557");
+	ffsprintf(f_out,  BORDER_COLOR "╔═");
+	for(col = 0; col < game.width; col++){ ffsprintf(f_out, "═════"); }
+	ffsprintf(f_out, "═╗");
 	//score line
 	cursor_to(2, 1);
 	ffsprintf(f_out,  BORDER_COLOR );
 	//ffsprintf(f_out, "\u2551" ESC "[7mScore: %d" ESC "[m", game.score); cursor_to(2, 23);ffsprintf(f_out, " \u2551");
-	ffsprintf(f_out, "║ Score: %d", game.score); cursor_to(2, 23);ffsprintf(f_out, " ║");
+	ffsprintf(f_out, "║ Score: %d", game.score); cursor_to(2, 3 + 5 * game.width);ffsprintf(f_out, " ║");
 	
 	// separator
 	cursor_to(3,1);
-	ffsprintf(f_out,  BORDER_COLOR "╠══════════════════════╣");
-	// for(col = 0; col < game.width; col++){ ffsprintf(f_out, "\u2550\u2550\u2550\u2550\u2550"); }
-	// ffsprintf(f_out, "\u2550\u2563");
+	ffsprintf(f_out,  BORDER_COLOR "╠═");
+	for(col = 0; col < game.width; col++){ ffsprintf(f_out, "═════"); }
+	ffsprintf(f_out, "═╣");
 	
 	cursor_to(4,1);
 	for(row = 0; row < game.height; row++){
@@ -325,11 +391,9 @@ void render(void){
 		ffsprintf(f_out, BORDER_COLOR " ║\n\r");
 	}
 	//bottom row
-	ffsprintf(f_out, BORDER_COLOR "╚══════════════════════╝");
-
-	// ffsprintf(f_out, BORDER_COLOR "\u255A\u2550");
-	// for(col = 0; col < game.width; col++){ ffsprintf(f_out, "\u2550\u2550\u2550\u2550\u2550"); }
-	// ffsprintf(f_out, "\u2550\u255D");
+	ffsprintf(f_out, BORDER_COLOR "╚═");
+	for(col = 0; col < game.width; col++){ ffsprintf(f_out, "═════"); }
+	ffsprintf(f_out, "═╝");
 
 	// for cell in board: uninvert
 	// for(col = 0; col < game.width; col++){
@@ -338,6 +402,8 @@ void render(void){
 	// 	}
 	// }
 
+	if(game.solved){ show_solved(); }
+
 	fflush(stdout);
 
 	//restore_cursor();
@@ -347,39 +413,13 @@ void render(void){
 
  no_moves_left()
 
- If the game board is full and no adjacent tiles have the same value, there are no legal moves remaining
+ If no direction would move or amalgamate any tile, there are no legal moves remaining
 
 ***********************************************************************/
 
 int no_moves_left(void){
 
-	// for each cell, testing the cell to the right and the cell below
-	// will cover all the cells
-	// For the rightmost cell in each row, we only need to test the cell beneath
-	// for the last row, we do not need to test the cells beneath
-	int row,col;
-	for( row = 0; row < N_ROWS-1; row++){
-
-		for( col = 0; col < N_COLS-1; col++){
-			// to the right
-			if( (~SMUSHED & game.board[col][ row]) == (~SMUSHED & game.board[col+1][row])){ return 0; }
-			// and below
-			if( (~SMUSHED & game.board[col][ row]) == (~SMUSHED & game.board[col][row+1]) ){ return 0; }
-
-		}
-		//TODO: BUG HERE? col value implied
-		//last column test below
-		if((~SMUSHED & game.board[col][row]) == (~SMUSHED & game.board[col][row+1]) ){ return 0; }
-	}
-
-	// last row
-	for( col = 0; col < N_COLS-1; col++){
-		// to the right
-		if((~SMUSHED & game.board[col][row]) == (~SMUSHED & game.board[col+1][row]) ){ return 0; }
-	}
-	//ffsprintf(f_out, "No moves left\n");
-	return 1;
-
+	return board_legal_moves(pack_board()) == 0;
 }
 
 
@@ -396,35 +436,20 @@ int no_moves_left(void){
 
 int insert_new_tile(void){
 
-	int empty_cells[N_ROWS*N_COLS];
-	int n_empties;
-
-	int random = ((rand() % 10));
-	int new_tile = (random != 0) ? 1 : 2;
-
-	// list empty slots
-	n_empties = 0;
-
-	for(int col = 0; col < N_COLS ; col++){
-		for(int row = 0; row < N_ROWS; row++){
+	board_t b = pack_board();
+	int n_empties = board_count_empty(b);
+	spawn_choice choice;
 
-			if(game.board[col][row] == 0){
-				empty_cells[n_empties] = col + row * N_COLS;
-				n_empties++;
-			}
-		}
-	}
-	// if list isn't empty, insert tile
-	if( n_empties != 0){
+	// if there is room, the spawn policy picks the slot and the value
+	if( n_empties != 0 && game.spawn(b, ((uint64_t)rand() << 32) ^ (uint64_t)rand(), &choice)){
 
-		// drop new_tile into random slot
-		random = ((rand() % n_empties));
+		int col = choice.cell % N_COLS, row = choice.cell / N_COLS;
 
-		game.board[empty_cells[random] % N_COLS][empty_cells[random] / N_COLS] = new_tile | INVERT;
+		game.board[col][row] = choice.value | INVERT;
 
 		--n_empties;
 
-		ffsprintf(f_out, "Inserting at %d, %d    (empties:%d)\n", random % 4, random / 4, n_empties);
+		ffsprintf(f_out, "Inserting at %d, %d    (empties:%d)\n", col, row, n_empties);
 
 	}else{ // TODO:  logic?
 
@@ -443,7 +468,8 @@ int insert_new_tile(void){
 void debug_cell_print(void){
 	for(int r = 0; r < N_ROWS; r++){
 
-		 ffsprintf(f_out, "\n%2d,%2d,%2d,%2d", game.board[0][ r],game.board[1][ r],game.board[2][ r],game.board[3][r]);
+		 ffsprintf(f_out, "\n");
+		 for(int c = 0; c < N_COLS; c++){ ffsprintf(f_out, "%s%2d", c ? "," : "", game.board[c][r]); }
 	}
 	// ffsprintf(f_out, "\n");
 }
@@ -460,49 +486,81 @@ typedef struct move_result{
 
 
 
-// process a 'vector' of cell values
+// one entry per tile taking part in a move: where it started, where it came
+// to rest and whether it amalgamated on arrival. Filled in by traverse(), consumed
+// by animate_move() so that slides and merges can be shown rather than inferred
+typedef struct tile_anim{
+
+	uint8_t from_col, from_row;
+	uint8_t to_col, to_row;
+	uint8_t value;   // tile value (log2) while in flight
+	bool    merged;  // lands on, and amalgamates with, the tile already at (to_col,to_row)
+
+}tile_anim;
+
+struct anim_list{
+
+	int       n;
+	tile_anim tiles[N_COLS * N_ROWS];
+
+}anim;
+
+#define MAX_LINE ((N_COLS > N_ROWS) ? N_COLS : N_ROWS)
+
+// recover board coordinates from a pointer into game.board
+static void cell_coords(const uint8_t* p, uint8_t* col, uint8_t* row){
+
+	ptrdiff_t off = p - &game.board[0][0];
+	*col = (uint8_t)(off / N_ROWS);
+	*row = (uint8_t)(off % N_ROWS);
+}
+
+// process a 'vector' of cell values, c[0] being the cell against the wall
+// tiles are pushed towards c[0], equal neighbours amalgamate once per move
 //
 // return: did we move?
 //         did the score change? 
 
-int remove_gaps(uint8_t** c, size_t sz){
-
-	int moved = 0;
-	for( int i = 1; i < sz; i++){
-	   
-	   if(!*c[i])continue;
-	   int j = i;
-	   while(j && !*c[j-1]){
-		  *c[j-1] = *c[j];   // move down ...
-		  *c[j] = 0;        // from here
-		  j--;   
-		  moved++;      
-	   }
-	}
-	return moved;
- }
-
  move_result traverse( uint8_t** c, size_t sz){
  
 	move_result  r = {.moved = false, .points = 0};
+
+	uint8_t line[MAX_LINE];    // resulting values
+	bool    smushed[MAX_LINE]; // prevent re-smushing
+	size_t  n = 0;             // tiles laid down so far
+	int     moves = 0;
  
-	int moves = remove_gaps(c, sz);
- 
-	for( int i = 1; i < sz; i++){
+	for( size_t i = 0; i < sz; i++){
  
-	   if(!*c[i])continue; // skip blank
+	   uint8_t v = *c[i];
+	   if(!v)continue; // skip blank
+
+	   tile_anim* a = &anim.tiles[anim.n++];
+	   cell_coords(c[i], &a->from_col, &a->from_row);
+	   a->value = v;
  
-	   if(*c[i] == *c[i-1]){         //smush  
-		  moves++; // a smush is a move       
-		  *c[i-1] = *c[i-1] + 1;     // tile value doubles
-		  if(*c[i-1] == 11){ game.won = true; /* hate the 'magic number' 2048 = 2^11*/}
-		  r.points += (1 << *c[i-1]);
-		  *c[i-1] |= SMUSHED;        // flag as new & prevent re-smushing
-		  *c[i] = 0;                 // remove smusher
-		  moves += remove_gaps(c, sz);
+	   if(n && line[n-1] == v && !smushed[n-1]){  //smush
+		  moves++; // a smush is a move
+		  line[n-1] = v + 1;         // tile value doubles
+		  if(line[n-1] == 11){ game.won = true; /* hate the 'magic number' 2048 = 2^11*/}
+		  r.points += (1 << line[n-1]);
+		  smushed[n-1] = true;
+		  a->merged = true;
+		  cell_coords(c[n-1], &a->to_col, &a->to_row);
+	   }else{
+		  if(n != i) moves++;        // slid into a gap
+		  line[n] = v;
+		  smushed[n] = false;
+		  a->merged = false;
+		  cell_coords(c[n], &a->to_col, &a->to_row);
+		  n++;
 	   }
- 
 	}
+
+	for( size_t i = 0; i < sz; i++){
+	   *c[i] = (i < n) ? (line[i] | (smushed[i] ? SMUSHED : 0)) : 0;  // flag as new
+	}
+
 	r.moved = moves ? true : false;
 	return r;
  }
@@ -511,6 +569,8 @@ int move_down(void){
 
    uint8_t* pcells[N_ROWS];
    int n_moved = 0;
+
+   anim.n = 0;
    
    for( int col = 0; col < N_COLS; col++){
    
@@ -535,6 +595,8 @@ int move_up(void){
 
 	uint8_t* pcells[N_ROWS];
 	int n_moved = 0;
+
+	anim.n = 0;
 	
 	for( int col = 0; col < N_COLS; col++){
 	
@@ -554,9 +616,11 @@ int move_up(void){
  
  int move_left(void){
 
-	uint8_t* pcells[N_ROWS];
+	uint8_t* pcells[N_COLS];
 	int n_moved = 0;
 
+	anim.n = 0;
+
 	for(int row = 0; row < N_ROWS; row++){
 
 		for( int col = 0; col < N_COLS; col++){
@@ -575,9 +639,11 @@ int move_up(void){
 
  int move_right(void){
 
-	uint8_t* pcells[N_ROWS];
+	uint8_t* pcells[N_COLS];
 	int n_moved = 0;
 
+	anim.n = 0;
+
 	for(int row = 0; row < N_ROWS; row++){
 
 		for( int col = 0; col < N_COLS; col++){
@@ -595,6 +661,106 @@ int move_up(void){
  }
 
 
+/***********************************************************************
+
+ animate_move()
+
+ Play back the tile movements recorded by the last move_*() as a short slide,
+ then highlight each merged tile with its new value.
+ Frames are paced off the monotonic clock: if we fall behind, stale frames are
+ dropped rather than queued, and any pending keypress ends the animation at once
+ so that it never adds input latency. The caller repaints the final board.
+
+***********************************************************************/
+
+#define ANIM_FPS   60
+#define ANIM_MS    100  // duration of a complete move
+#define ANIM_SLIDE 750  // permille of it spent sliding, the rest shows merges
+
+static long long now_us(void){
+
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+// wait up to usec for a key; true if one is waiting to be read
+static bool key_pending(long long usec){
+
+	fd_set fds;
+	struct timeval tv = { .tv_sec = usec / 1000000, .tv_usec = usec % 1000000 };
+
+	FD_ZERO(&fds);
+	FD_SET(STDIN_FILENO, &fds);
+	return select(STDIN_FILENO + 1, &fds, NULL, NULL, &tv) > 0;
+}
+
+// draw every tile at its position 'permille' of the way through the animation:
+// tiles slide until ANIM_SLIDE, then merged pairs show their doubled value
+static void draw_anim_frame(int permille){
+
+	int row, col;
+	int along = (permille >= ANIM_SLIDE) ? 1000 : permille * 1000 / ANIM_SLIDE;
+
+	// blank the board interior
+	for(row = 0; row < 3 * N_ROWS; row++){
+		cursor_to(4 + row, 3);
+		for(col = 0; col < N_COLS; col++){ ffsprintf(f_out, "     "); }
+	}
+
+	// merging tiles go last, so that on arrival they cover the tile they merge with
+	for(int pass = 0; pass < 2; pass++){
+		for(int i = 0; i < anim.n; i++){
+
+			tile_anim* a = &anim.tiles[i];
+			if(a->merged != (pass == 1)){ continue; }
+
+			bool landed = a->merged && permille >= ANIM_SLIDE;
+			int c = a->value + landed;
+			if(c > MAX_SYMBOL - 1){ c = MAX_SYMBOL - 1; }
+
+			int y0 = 4 + 3 * a->from_row, y1 = 4 + 3 * a->to_row;
+			int x0 = 3 + 5 * a->from_col, x1 = 3 + 5 * a->to_col;
+			int y = y0 + (y1 - y0) * along / 1000;
+			int x = x0 + (x1 - x0) * along / 1000;
+
+			cursor_to(y, x);     ffsprintf(f_out, "%s┌───┐", symbols[c][SYM_COLOR]);
+			cursor_to(y + 1, x);
+			if(landed){ ffsprintf(f_out, "│" ESC "[7m%s" ESC "[m%s│", symbols[c][SYM_LEGEND], symbols[c][SYM_COLOR]); }
+			else{       ffsprintf(f_out, "│%s│", symbols[c][SYM_LEGEND]); }
+			cursor_to(y + 2, x); ffsprintf(f_out, "└───┘");
+		}
+	}
+	ffsprintf(f_out, BORDER_COLOR);
+}
+
+void animate_move(void){
+
+	const long long frame_us = 1000000 / ANIM_FPS;
+	const long long total_us = ANIM_MS * 1000LL;
+	long long start = now_us();
+	long long last_frame = -1;
+
+	if(anim.n == 0){ return; }
+
+	while(1){
+
+		long long elapsed = now_us() - start;
+		if(elapsed >= total_us){ break; }
+
+		// only ever draw the frame that is due now; any we overslept are dropped
+		long long frame = elapsed / frame_us;
+		if(frame != last_frame){
+			draw_anim_frame((int)(elapsed * 1000 / total_us));
+			last_frame = frame;
+		}
+
+		long long wait = (frame + 1) * frame_us - (now_us() - start);
+		if(wait < 0){ wait = 0; }
+		if(key_pending(wait)){ break; } // player is ahead of us: skip the rest
+	}
+}
+
 char read_key(void){
 
     int nread;
@@ -641,6 +807,9 @@ int handle_key_press(void){
 	int key, n_cells_moved = 0;
 
 	valid_key_t valid_key = VK_NONE; 
+
+	// keys for directions that would not change the board are ignored outright
+	unsigned legal = board_legal_moves(pack_board());
 	
 	while( (n_cells_moved == 0) && !valid_key ){
 
@@ -658,29 +827,38 @@ int handle_key_press(void){
 
 			case 'w':
 			case 'W':
+			if(!(legal & (1u << DIR_UP))) break;
 			valid_key = VK_UP;
 			n_cells_moved = move_up();
 			break;
 
 			case 'a':
 			case 'A':
+			if(!(legal & (1u << DIR_LEFT))) break;
 			n_cells_moved = move_left();
 			valid_key = VK_LEFT;
 			break;
 
 			case 's':
 			case 'S':
+			if(!(legal & (1u << DIR_DOWN))) break;
 			valid_key = VK_DOWN;
 			n_cells_moved = move_down();
 			break;
 
 			case 'd':
 			case 'D':
+			if(!(legal & (1u << DIR_RIGHT))) break;
 			n_cells_moved = move_right();
 			valid_key = VK_RIGHT;
 
 			break;
 
+			case 'h':
+			case 'H':
+			show_hint();
+			break;
+
 			case 'Q':
 			case 'q':
 			valid_key = VK_QUIT;
@@ -783,8 +961,15 @@ int play_2048(void){
 
 		render();
 
+		// think about the position while the player does, never before it is on screen
+		if(game.hints){ hint_post(pack_board()); }
+
 		if( handle_key_press() > 0){ //got a keypress that results in some movement of a tile
 
+			if(game.hints){ hint_cancel(); }
+
+			animate_move();
+
 			if(once && game.won){
 				once = false;
 				endgame();
@@ -809,15 +994,92 @@ game_over:
 
 	return 0;
 }
+struct options{
+
+	bool analyze;   // --analyze: evaluate positions from stdin instead of playing
+	bool binary;    // --binary:  ... given as raw 64 bit boards
+	int  depth;     // --depth N
+	int  threads;   // --threads N, 0 for one per core
+	const char* bot; // --bot NAME: serve the shared-memory bot protocol instead of playing
+	const char* bench; // --bench NAME: run a micro-benchmark
+
+}opts = { .depth = ANALYZE_DEPTH };
+
+static void usage(const char* prog){
+
+	fprintf(stderr,
+		"usage: %s [options] [logfile]\n"
+		"  --table FILE              show the optimal move from a solved table\n"
+		"  --spawn random|adversary  tile spawner\n"
+		"  --spawn-us N              adversary's time budget per tile\n"
+		"  --analyze                 evaluate positions from stdin instead of playing,\n"
+		"    [--binary] [--depth N] [--threads N]\n"
+		"  --bot NAME                serve the shared-memory bot protocol\n"
+		"  --bench sym|mask          run a micro-benchmark\n", prog);
+	exit(1);
+}
+
+// the argument after option argv[*i], or usage() if there is none
+static const char* option_value(int argc, char** argv, int* i){
+
+	if(*i + 1 >= argc){ fprintf(stderr, "%s needs a value\n", argv[*i]); usage(argv[0]); }
+	return argv[++*i];
+}
+
 void consider_options(int argc, char** argv){ // quik and dirty adding logging option
 
-	FILE* f = fopen( argv[1], "w" ); //( argv[1], O_WRONLY | O_CREAT );
-	game.logfile = f;
+	const char* logname = NULL;
+
+	for(int i = 1; i < argc; i++){
+
+		if(!strcmp(argv[i], "--analyze")){
+			opts.analyze = true;
+		}else if(!strcmp(argv[i], "--bot")){
+			opts.bot = option_value(argc, argv, &i);
+		}else if(!strcmp(argv[i], "--bench")){
+			opts.bench = option_value(argc, argv, &i);
+		}else if(!strcmp(argv[i], "--spawn")){
+			game.spawn = spawn_policy_named(option_value(argc, argv, &i));
+			if(!game.spawn){ fprintf(stderr, "unknown spawn policy '%s' (try: random, adversary)\n", argv[i]); exit(1); }
+		}else if(!strcmp(argv[i], "--spawn-us")){
+			spawn_budget_us = atol(option_value(argc, argv, &i));
+		}else if(!strcmp(argv[i], "--binary")){
+			opts.binary = true;
+		}else if(!strcmp(argv[i], "--depth")){
+			opts.depth = atoi(option_value(argc, argv, &i));
+			if(opts.depth < 1 || opts.depth > SEARCH_MAX_DEPTH){ fprintf(stderr, "--depth must be 1..%d\n", SEARCH_MAX_DEPTH); exit(1); }
+		}else if(!strcmp(argv[i], "--threads")){
+			opts.threads = atoi(option_value(argc, argv, &i));
+		}else if(!strcmp(argv[i], "--table")){
+			game.solved = table_open(option_value(argc, argv, &i));
+			if(!game.solved){ exit(1); }
+		}else if(argv[i][0] == '-' || logname){
+			fprintf(stderr, "unexpected argument '%s'\n", argv[i]);
+			usage(argv[0]);
+		}else{
+			logname = argv[i];
+		}
+	}
+
+	if(logname){
+		game.logfile = fopen(logname, "w");
+		if(!game.logfile){ perror(logname); exit(1); }
+	}
 }
 int main(int argc, char** argv){
 
+	game.spawn = spawn_random;
+
 	if(argc > 1) consider_options(argc, argv);
 
+	board_init();
+
+	if(opts.analyze){ return analyze(stdin, stdout, opts.binary, opts.depth, opts.threads); }
+	if(opts.bot){ return bot_serve(opts.bot, game.spawn); }
+	if(opts.bench){ return bench(opts.bench); }
+
+	game.hints = hint_start();
+
 	//RNG go
 	srandom( (unsigned)time(NULL));
 